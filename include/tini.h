@@ -8,6 +8,13 @@
 #include <sys/types.h>
 #include <stdio.h>
 
+#ifdef __cplusplus
+// C++ sees the value node as `struct tini_node`, leaving the name `tini` to
+// the namespace declared in tini.hpp
+# define tini tini_node
+extern "C" {
+#endif
+
 enum tini_result
 {
 	TINI_SUCCESS,
@@ -24,6 +31,46 @@ enum tini_result
 	TINI_UNUSED_KEY,
 	TINI_MISSING_SECTION,
 	TINI_MISSING_KEY,
+	TINI_ENUM_UNKNOWN,
+	TINI_DURATION_FORMAT,
+	TINI_DURATION_TOO_BIG,
+	TINI_SIZE_FORMAT,
+	TINI_SIZE_TOO_BIG,
+	TINI_TIME_FORMAT,
+	TINI_TIME_RANGE,
+	TINI_DUPLICATE_KEY,
+	TINI_REQUIRED_KEY,
+	TINI_VALUE_TOO_SMALL,
+	TINI_VALUE_TOO_BIG,
+	TINI_LENGTH_TOO_SHORT,
+	TINI_LENGTH_TOO_LONG,
+	TINI_VALUE_PATTERN,
+	TINI_MISSING_PARENT,
+	TINI_INHERIT_CYCLE,
+	TINI_INVALID_UTF8,
+	TINI_CONTROL_CHAR,
+	TINI_OUTPUT_ERROR,
+	TINI_NO_MEMORY,
+};
+
+enum tini_flag
+{
+	TINI_DENY_DUPLICATES = 1 << 0,
+	TINI_BATCH = 1 << 1,
+	TINI_INHERIT = 1 << 2,
+	TINI_VALIDATE = 1 << 3,
+	TINI_RECOVER = 1 << 4,
+	TINI_MULTILINE = 1 << 5,
+};
+
+enum tini_batch_option
+{
+	TINI_BATCH_SYNC = 1 << 0,
+};
+
+enum tini_field_flag
+{
+	TINI_REQUIRED = 1 << 0,
 };
 
 enum tini_type
@@ -43,6 +90,15 @@ enum tini_type
 	TINI_UNSIGNED,
 	TINI_NUMBER,
 	TINI_NODE,
+	TINI_ENUM,
+	TINI_FLAGS,
+	TINI_DURATION,
+	TINI_SIZE,
+	TINI_TIME,
+
+	// a value node spanning several lines, see `tini_segment`; it comes last
+	// so the value types keep their numbering in compiled field tables
+	TINI_CONTINUED,
 };
 
 #define tini_type(v) _Generic((v), \
@@ -60,6 +116,11 @@ enum tini_type
 		double: TINI_NUMBER, \
 		struct tini: TINI_NODE)
 
+/**
+ * The parser does not track lines, so `line_start` is NULL and `line` and
+ * `column` are zero until the node is passed to `tini_locate`. Error nodes
+ * are always located.
+ */
 struct tini
 {
 	const char *start;
@@ -70,42 +131,206 @@ struct tini
 	uint32_t column;
 };
 
+/**
+ * A compact node holding only the offset and length within the parsed text,
+ * for keeping many nodes around.
+ */
+struct tini_span
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+static inline struct tini_span
+tini_span_make(const char *txt, const struct tini *node)
+{
+	struct tini_span span = { (uint32_t)(node->start - txt), node->length };
+	return span;
+}
+
+static inline struct tini
+tini_span_node(const char *txt, struct tini_span span, enum tini_type type)
+{
+	struct tini node = { txt + span.offset, span.length, type, NULL, 0, 0 };
+	return node;
+}
+
 struct tini_error
 {
-	const struct tini node;
+	struct tini node;
 	const char *msg;
+	const char *arg;
 	enum tini_result code;
 };
 
+struct tini_phash
+{
+	int32_t *disp;
+	uint32_t *slots;
+	uint32_t nbuckets;
+	uint32_t mask;
+};
+
+struct tini_enum_value
+{
+	const char *name;
+	int64_t value;
+};
+
+struct tini_enum
+{
+	const struct tini_enum_value *values;
+	size_t nvalues;
+	struct tini_phash hash;
+};
+
+#define tini_enum_make(_values) { \
+	.values = (_values), \
+	.nvalues = sizeof(_values) / sizeof((_values)[0]), \
+}
+
+enum tini_check_mask
+{
+	TINI_CHECK_RANGE = 1 << 0,
+	TINI_CHECK_LENGTH = 1 << 1,
+	TINI_CHECK_CHARSET = 1 << 2,
+};
+
+/**
+ * Constraints on a field value, checked when the field is set. The range is
+ * compared against the converted value using `i` for signed, duration,
+ * time, enum and flag fields, `u` for unsigned and size fields, and `d` for
+ * numbers. The length, prefix and character set are checked against the
+ * value text.
+ */
+struct tini_check
+{
+	unsigned mask;
+	union { int64_t i; uint64_t u; double d; } min, max;
+	uint32_t minlen, maxlen;
+	const char *prefix;
+	uint64_t charset[4];
+};
+
+#define tini_check_int(_min, _max, ...) \
+	((struct tini_check) { .mask = TINI_CHECK_RANGE, \
+			.min.i = (_min), .max.i = (_max), __VA_ARGS__ })
+
+#define tini_check_uint(_min, _max, ...) \
+	((struct tini_check) { .mask = TINI_CHECK_RANGE, \
+			.min.u = (_min), .max.u = (_max), __VA_ARGS__ })
+
+#define tini_check_number(_min, _max, ...) \
+	((struct tini_check) { .mask = TINI_CHECK_RANGE, \
+			.min.d = (_min), .max.d = (_max), __VA_ARGS__ })
+
+#define tini_check_length(_min, _max, ...) \
+	((struct tini_check) { .mask = TINI_CHECK_LENGTH, \
+			.minlen = (_min), .maxlen = (_max), __VA_ARGS__ })
+
 struct tini_field
 {
 	const char *const name;
 	const size_t size;
 	const size_t offset;
 	const enum tini_type type;
+	const struct tini_enum *const enums;
+	const unsigned flags;
+	const struct tini_check *const check;
 };
 
-#define tini_field_make_as(_struct, _member, _name) \
+#define tini_field_type_as(_struct, _member, _name, _type, ...) \
 	((struct tini_field) { \
 		.name = _name, \
 		.size = sizeof(((_struct *)0)->_member), \
 		.offset = offsetof(_struct, _member), \
-		.type = tini_type(((_struct *)0)->_member) \
+		.type = _type, \
+		__VA_ARGS__ \
 	})
 
-#define tini_field_make(_struct, _member) \
-	tini_field_make_as(_struct, _member, #_member)
+#define tini_field_make_as(_struct, _member, _name, ...) \
+	tini_field_type_as(_struct, _member, _name, \
+			tini_type(((_struct *)0)->_member), __VA_ARGS__)
+
+#define tini_field_make(_struct, _member, ...) \
+	tini_field_make_as(_struct, _member, #_member, __VA_ARGS__)
+
+#define tini_field_duration(_struct, _member, ...) \
+	tini_field_type_as(_struct, _member, #_member, TINI_DURATION, __VA_ARGS__)
+
+#define tini_field_size(_struct, _member, ...) \
+	tini_field_type_as(_struct, _member, #_member, TINI_SIZE, __VA_ARGS__)
+
+#define tini_field_time(_struct, _member, ...) \
+	tini_field_type_as(_struct, _member, #_member, TINI_TIME, __VA_ARGS__)
+
+#define tini_field_enum_as(_struct, _member, _name, _type, _enums, ...) \
+	tini_field_type_as(_struct, _member, _name, _type, \
+			.enums = _enums, __VA_ARGS__)
+
+#define tini_field_enum(_struct, _member, _enums, ...) \
+	tini_field_enum_as(_struct, _member, #_member, TINI_ENUM, _enums, __VA_ARGS__)
+
+#define tini_field_flags(_struct, _member, _enums, ...) \
+	tini_field_enum_as(_struct, _member, #_member, TINI_FLAGS, _enums, __VA_ARGS__)
+
+/**
+ * A key/value pair delivered to `assign_batch`. The callback stores the result
+ * of each assignment in `rc`.
+ */
+struct tini_pair
+{
+	struct tini key;
+	struct tini value;
+	enum tini_result rc;
+};
+
+/**
+ * Where a bound field was last set: the 1-based line of its value and the
+ * context's `file` and `layer` at the time. A zero line means the field was
+ * never set and holds its default.
+ */
+struct tini_origin
+{
+	uint32_t line;
+	uint16_t file;
+	uint16_t layer;
+};
 
 struct tini_section
 {
 	const struct tini_field *fields;
 	size_t nfields;
 	void *target;
+	const void *defaults;
+	size_t size;
+	uint64_t *seen;
+	/**
+	 * When set by `load_section`, holds `nfields` records parallel to
+	 * `fields` that `tini_assign` updates as each field is set. Such sections
+	 * are assigned one pair at a time even with `TINI_BATCH`.
+	 */
+	struct tini_origin *origins;
+	// the origin of the value being assigned
+	struct tini_origin origin;
 	enum tini_result (*assign)(
 			const struct tini_section *section,
 			const struct tini *key,
 			const struct tini *value,
 			void *udata);
+	/**
+	 * When set, the section's pairs are collected and delivered together
+	 * instead of through `assign`. Pairs are flushed at the end of the
+	 * section, or every `batch` pairs when non-zero. Returns the number of
+	 * pairs with a non-success `rc`. With `TINI_BATCH`, sections that keep the
+	 * default `assign` use `tini_assign_batch`.
+	 */
+	size_t (*assign_batch)(
+			const struct tini_section *section,
+			struct tini_pair *pairs,
+			size_t n,
+			void *udata);
+	size_t batch;
 };
 
 #define tini_section_set(section, _target, _fields) do { \
@@ -115,18 +340,167 @@ struct tini_section
 	__tmp->target = (_target); \
 } while (0)
 
+#define tini_section_set_defaults(section, _target, _fields, _defaults) do { \
+	struct tini_section *__dtmp = (section); \
+	tini_section_set(__dtmp, _target, _fields); \
+	__dtmp->defaults = (_defaults); \
+	__dtmp->size = sizeof(*(_defaults)); \
+} while (0)
+
+/**
+ * Routes a section name to a field table and the offset of the section's
+ * struct within the target passed to `tini_parse_into`. The section named ""
+ * holds the global keys, with field offsets relative to the target itself.
+ * Defaults may be given with `.defaults` and `.size`.
+ */
+struct tini_schema_section
+{
+	const char *name;
+	const struct tini_field *fields;
+	size_t nfields;
+	size_t offset;
+	const void *defaults;
+	size_t size;
+};
+
+struct tini_schema
+{
+	const struct tini_schema_section *sections;
+	size_t nsections;
+	struct tini_phash hash;
+};
+
+#define tini_schema_section_as(_struct, _member, _name, _fields, ...) { \
+	.name = (_name), \
+	.fields = (_fields), \
+	.nfields = sizeof(_fields) / sizeof((_fields)[0]), \
+	.offset = offsetof(_struct, _member), \
+	__VA_ARGS__ \
+}
+
+#define tini_schema_section_make(_struct, _member, _fields, ...) \
+	tini_schema_section_as(_struct, _member, #_member, _fields, __VA_ARGS__)
+
+#define tini_schema_global(_fields, ...) { \
+	.name = "", \
+	.fields = (_fields), \
+	.nfields = sizeof(_fields) / sizeof((_fields)[0]), \
+	__VA_ARGS__ \
+}
+
+#define tini_schema_make(_sections) { \
+	.sections = (_sections), \
+	.nsections = sizeof(_sections) / sizeof((_sections)[0]), \
+}
+
+#define TINI_COLLECTION_BLOCKS 32
+
+/**
+ * Storage for labelled sections such as `[backend : api-1]`. Calling
+ * `tini_collection_load` from `load_section` binds the section into the
+ * element for its label, adding one initialized from `defaults` the first
+ * time a label is seen, so repeated labels merge. An unlabelled section uses
+ * the label "".
+ *
+ * Elements are allocated in blocks that double in size and never move, and
+ * are numbered in order of first appearance for `tini_collection_at`. Labels
+ * are copied, and a hash index finds elements by label.
+ */
+struct tini_collection
+{
+	const struct tini_field *fields;
+	size_t nfields;
+	size_t size;
+	const void *defaults;
+	size_t count;
+	char *blocks[TINI_COLLECTION_BLOCKS];
+	struct tini_span *labels;
+	size_t labelcap;
+	char *names;
+	size_t nameslen;
+	size_t namescap;
+	uint32_t *index;
+	size_t mask;
+};
+
+#define tini_collection_make(_struct, _fields, ...) { \
+	.fields = (_fields), \
+	.nfields = sizeof(_fields) / sizeof((_fields)[0]), \
+	.size = sizeof(_struct), \
+	__VA_ARGS__ \
+}
+
+extern enum tini_result
+tini_collection_load(struct tini_collection *c, struct tini_section *section,
+		const struct tini *label);
+
+extern void *
+tini_collection_at(const struct tini_collection *c, size_t i);
+
+extern const char *
+tini_collection_label(const struct tini_collection *c, size_t i);
+
+extern void *
+tini_collection_find(const struct tini_collection *c,
+		const char *label, size_t len);
+
+extern void
+tini_collection_free(struct tini_collection *c);
+
+struct tini_interned
+{
+	const char *str;
+	uint32_t length;
+	uint32_t hash;
+};
+
+/**
+ * A pool of NUL-terminated copies of strings, with one copy per distinct
+ * string. Interned strings are stored in an arena and never move, so equal
+ * strings from the same pool compare equal by pointer, and each also has a
+ * dense ID in order of first appearance. A zeroed pool is empty.
+ *
+ * Only `tini_intern` and `tini_intern_value` modify the pool; once filled it
+ * may be shared read-only across threads.
+ */
+struct tini_intern
+{
+	struct tini_intern_chunk *chunks;
+	char *next;
+	size_t avail;
+	struct tini_interned *strings;
+	size_t count;
+	size_t cap;
+	uint32_t *index;
+	size_t mask;
+};
+
+static inline const char *
+tini_intern_get(const struct tini_intern *pool, uint32_t id)
+{
+	return id < pool->count ? pool->strings[id].str : NULL;
+}
+
 struct tini_ctx
 {
 	const char *txt;
 	size_t txtlen;
+	// the line txt starts on when it is one window of a longer input
+	uint32_t txtline;
 	struct tini_error err[10];
 	unsigned nerr;
+	// errors are located incrementally from the last located position
+	const char *cursor;
+	uint32_t cursor_line;
 	enum tini_result (*load_section)(
 			struct tini_section *section,
 			const struct tini *name,
 			const struct tini *label,
 			void *udata);
 	void *udata;
+	// recorded in the origins of fields bound from this text
+	uint16_t file;
+	uint16_t layer;
 };
 
 #define tini_ctx_make(_load_section, _udata) { \
@@ -135,11 +509,299 @@ struct tini_ctx
 	.udata = (_udata), \
 }
 
+/**
+ * Loads and parses many files. Reads are submitted through io_uring when it
+ * is available (or plain syscalls with `TINI_BATCH_SYNC`), with at most
+ * `depth` files in flight, and each file is parsed on one of `nworkers`
+ * threads as soon as it has been read. With no workers, files are parsed on
+ * the calling thread.
+ *
+ * Each file is parsed with a context whose udata is the result of `begin`,
+ * or `udata` when `begin` is NULL. Every path is then reported once through
+ * `done`, with `err` set to an errno value if the file could not be read.
+ * The context and its text are only valid during the callback. All of the
+ * callbacks may be invoked concurrently from different workers. If the batch
+ * fails, files it did not finish are reported with the errno that stopped it
+ * before -1 is returned.
+ */
+struct tini_batch
+{
+	const char *const *paths;
+	size_t npaths;
+	enum tini_result (*load_section)(
+			struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata);
+	void *(*begin)(
+			size_t index,
+			void *udata);
+	void (*done)(
+			struct tini_ctx *ctx,
+			size_t index,
+			int err,
+			enum tini_result rc,
+			void *udata);
+	void *udata;
+	int flags;
+	unsigned options;
+	unsigned depth;
+	unsigned nworkers;
+};
+
+enum tini_event_type
+{
+	TINI_EVENT_NONE,
+	TINI_EVENT_SECTION,
+	TINI_EVENT_VALUE,
+	TINI_EVENT_ERROR,
+};
+
+struct tini_event
+{
+	enum tini_event_type type;
+	enum tini_result code;
+	struct tini name;
+	struct tini value;
+};
+
+struct tini_iter
+{
+	const char *txt;
+	const char *p;
+	const char *pe;
+	const char *mark;
+	const char *located;
+	uint32_t line;
+	// only `TINI_MULTILINE` is used, and may be set after `tini_iter_init`
+	int flags;
+	int cs;
+};
+
+extern void
+tini_iter_init(struct tini_iter *it, const char *txt, size_t txtlen);
+
+extern bool
+tini_next(struct tini_iter *it, struct tini_event *ev);
+
+/**
+ * Resumes iteration after an error event by skipping the rest of the broken
+ * line. The next event comes from the line after it.
+ */
+extern void
+tini_iter_recover(struct tini_iter *it);
+
+/**
+ * Finds the first byte in [txt, end) that is not valid UTF-8 or is a control
+ * character other than whitespace. Returns NULL if the text is valid, or the
+ * offending byte with `rc` set to `TINI_INVALID_UTF8` or `TINI_CONTROL_CHAR`.
+ */
+extern const char *
+tini_validate(const char *txt, const char *end, enum tini_result *rc);
+
+extern void
+tini_locate(const char *txt, struct tini *node);
+
+/**
+ * Locates a node in the context's text, resuming from the last node located
+ * there when it comes later in the text.
+ */
+extern void
+tini_ctx_locate(struct tini_ctx *ctx, struct tini *node);
+
+/**
+ * Reads text from a file descriptor in windows of about `window` bytes,
+ * decompressing it on the way when it starts with the gzip magic.
+ * Each call to `tini_stream_next` returns the text up to the last newline in
+ * the window; the partial line after it is carried into the next call, so
+ * only a line longer than the window grows the buffer. Returns 0 at the end
+ * of the input or -1 with `errno` set on failure, which is `EBADMSG` for
+ * corrupt or truncated input. The text is valid until the next call. Opening
+ * gzip input fails with `EPROTONOSUPPORT` when tini is built without zlib.
+ *
+ * Windows suit consumers that are done with each line once it is read, such
+ * as `tini_iter` converting to JSON. To bind a stream, use
+ * `tini_stream_parse` instead.
+ */
+struct tini_stream;
+
+extern struct tini_stream *
+tini_stream_open(int fd, size_t window);
+
+extern ssize_t
+tini_stream_next(struct tini_stream *s, const char **txt);
+
+/**
+ * Binds the rest of the stream like `tini_parse`, a window at a time, so
+ * compressed input is bound without inflating all of it first. Windows are
+ * kept until `tini_stream_close`, since errors and `TINI_NODE` fields point
+ * into them, and errors are located by their line in the whole input.
+ * Returns 0 with the result in `rc`, or -1 with `errno` set if the input
+ * could not be read, leaving what was bound before the failure.
+ */
+extern int
+tini_stream_parse(struct tini_stream *s, struct tini_ctx *ctx, int flags,
+		enum tini_result *rc);
+
+extern void
+tini_stream_close(struct tini_stream *s);
+
 extern enum tini_result
 tini_parse(struct tini_ctx *ctx,
 		const char *txt, size_t txtlen,
 		int flags);
 
+/**
+ * Parses into `target`, routing each section through `schema` in place of
+ * the context's `load_section` callback. Compiling the schema first replaces
+ * the linear name scan with a perfect hash lookup.
+ */
+extern enum tini_result
+tini_parse_into(struct tini_ctx *ctx,
+		const struct tini_schema *schema, void *target,
+		const char *txt, size_t txtlen,
+		int flags);
+
+/**
+ * Applies override lines of the form `[section] key = value` to
+ * configuration that is already bound, routing them through `load_section`
+ * and the field tables like `tini_parse`. The section is written as in a
+ * header, with an optional label as in `[backend : api] port = 80`, so
+ * section names and keys may contain dots. A key without a section is
+ * global, and blank lines and comments are skipped. Defaults are not
+ * applied.
+ *
+ * The patch is applied atomically: if any line fails, every field it set is
+ * restored and the first error is returned. Fields of type `struct tini`
+ * refer to the patch text, which must then outlive them.
+ */
+extern enum tini_result
+tini_patch(struct tini_ctx *ctx,
+		const char *txt, size_t txtlen,
+		int flags);
+
+/**
+ * Applies a patch to `target`, routing sections through `schema` like
+ * `tini_parse_into`.
+ */
+extern enum tini_result
+tini_patch_into(struct tini_ctx *ctx,
+		const struct tini_schema *schema, void *target,
+		const char *txt, size_t txtlen,
+		int flags);
+
+extern int
+tini_batch_load(const struct tini_batch *batch);
+
+#define TINI_OVERLAY_MAX 32
+
+/**
+ * A stack of configuration layers, such as built-in defaults, system, host
+ * and environment files, bound as a single configuration. Each layer is
+ * parsed once into a merged index with a slot per distinct section and key,
+ * and each slot resolves to the value from the highest layer that sets it.
+ * Replacing a layer only updates the slots its old and new text set.
+ *
+ * Layer text is not copied and must stay valid until the layer is replaced or
+ * the overlay is freed. `tini_overlay_bind` binds the winning values through
+ * the context like `tini_parse`, with each section loaded once and its keys
+ * in order of first appearance.
+ */
+struct tini_overlay;
+
+extern struct tini_overlay *
+tini_overlay_new(unsigned nlayers);
+
+extern void
+tini_overlay_free(struct tini_overlay *ov);
+
+/**
+ * Replaces a layer with a new text, or clears it when `txtlen` is zero. On a
+ * syntax error the previous text of the layer stays in effect. The context's
+ * `file` is kept with the layer for the origins of the values it sets.
+ */
+extern enum tini_result
+tini_overlay_set(struct tini_overlay *ov, struct tini_ctx *ctx,
+		unsigned layer, const char *txt, size_t txtlen,
+		int flags);
+
+/**
+ * Finds the winning value for a key. The global section is named "" and
+ * `label` is NULL for unlabelled sections. Returns the layer the value came
+ * from, or -1 if no layer sets the key.
+ */
+extern int
+tini_overlay_get(const struct tini_overlay *ov,
+		const char *section, const char *label, const char *key,
+		struct tini *value);
+
+extern enum tini_result
+tini_overlay_bind(const struct tini_overlay *ov, struct tini_ctx *ctx,
+		int flags);
+
+#define TINI_SHM_ALIGN 64
+
+/**
+ * Publishes bound configuration to processes forked after `tini_shm_init`.
+ * Each call to `tini_shm_publish` copies the data into a new sealed memfd
+ * and bumps the generation in a control page shared with the workers.
+ * The data must be position independent: bound fields are, since strings
+ * are stored inline, but `TINI_NODE` fields point into the parsed text and
+ * must not be published.
+ *
+ * The latest region's descriptor is kept queued on a socketpair created by
+ * `tini_shm_init`. Workers call `tini_shm_attach` to peek at the queue,
+ * which hands them their own duplicate of the descriptor with `SCM_RIGHTS`,
+ * and map the region read-only. No access to the publisher's /proc entries
+ * is needed, so workers may drop privileges after the fork.
+ */
+struct tini_shm_control
+{
+	uint64_t generation;
+};
+
+struct tini_shm
+{
+	struct tini_shm_control *ctl;
+	int fd;
+	int sock[2];
+};
+
+struct tini_shm_view
+{
+	const void *data;
+	size_t size;
+	uint64_t generation;
+	void *map;
+	size_t maplen;
+};
+
+extern int
+tini_shm_init(struct tini_shm *shm);
+
+extern void
+tini_shm_free(struct tini_shm *shm);
+
+extern int
+tini_shm_publish(struct tini_shm *shm, const void *data, size_t size);
+
+/**
+ * Maps the latest published region into `view`, which starts zeroed. Returns
+ * 1 if a new generation was mapped, 0 if the view is current, or -1 with
+ * `errno` set.
+ */
+extern int
+tini_shm_attach(const struct tini_shm *shm, struct tini_shm_view *view);
+
+extern void
+tini_shm_detach(struct tini_shm_view *view);
+
+static inline uint64_t
+tini_shm_generation(const struct tini_shm *shm)
+{
+	return __atomic_load_n(&shm->ctl->generation, __ATOMIC_ACQUIRE);
+}
+
 extern bool
 tini_eq(const struct tini *node, const char *val, size_t len);
 
@@ -148,6 +810,24 @@ tini_eq(const struct tini *node, const char *val, size_t len);
 	tini_eq(node, __str, strlen(__str)); \
 })
 
+/**
+ * Iterates over the pieces of a value without copying them. A value of type
+ * `TINI_CONTINUED` is joined from its lines: a line ending in a backslash,
+ * or a backslash and a carriage return, runs into the next one with the
+ * backslash and indentation removed, an
+ * indented line is joined with its newline and without its indentation, and
+ * a heredoc is its body without the final newline. Any other value is a
+ * single segment. Start with `cursor` set to NULL.
+ */
+extern bool
+tini_segment(const struct tini *value, const char **cursor, struct tini *seg);
+
+/**
+ * Returns the length of a value once its segments are joined.
+ */
+extern size_t
+tini_length(const struct tini *value);
+
 extern enum tini_result
 tini_str(char *target, size_t len, const struct tini *value);
 
@@ -160,23 +840,211 @@ tini_bool(bool *target, const struct tini *value);
 extern enum tini_result
 tini_double(double *target, const struct tini *value);
 
+extern enum tini_result
+tini_duration(int64_t *target, const struct tini *value);
+
+extern enum tini_result
+tini_size(uint64_t *target, const struct tini *value);
+
+extern enum tini_result
+tini_time(int64_t *target, const struct tini *value);
+
 extern char *
 tini_copy(const struct tini *value);
 
+extern int
+tini_enum_compile(struct tini_enum *e);
+
+extern void
+tini_enum_free(struct tini_enum *e);
+
+extern const struct tini_enum_value *
+tini_enum_find(const struct tini_enum *e, const char *name, size_t len);
+
+/**
+ * Returns the interned copy of the string, adding it if it is new, and sets
+ * `id` when it is not NULL. Returns NULL if memory could not be allocated.
+ */
+extern const char *
+tini_intern(struct tini_intern *pool, const char *s, size_t len, uint32_t *id);
+
+extern const char *
+tini_intern_value(struct tini_intern *pool, const struct tini *value, uint32_t *id);
+
+/**
+ * Returns the interned copy of the string, or NULL if it has not been added.
+ */
+extern const char *
+tini_intern_find(const struct tini_intern *pool, const char *s, size_t len,
+		uint32_t *id);
+
+extern void
+tini_intern_free(struct tini_intern *pool);
+
+extern int
+tini_schema_compile(struct tini_schema *s);
+
+extern void
+tini_schema_free(struct tini_schema *s);
+
+extern const struct tini_schema_section *
+tini_schema_find(const struct tini_schema *s, const char *name, size_t len);
+
+extern enum tini_result
+tini_enum_parse(int64_t *target, const struct tini_enum *e,
+		const struct tini *value);
+
+extern enum tini_result
+tini_flags_parse(int64_t *target, const struct tini_enum *e,
+		const struct tini *value);
+
+extern const struct tini *
+tini_error_node(const struct tini *key, const struct tini *value,
+		enum tini_result rc);
+
 extern void
 tini_add_error(struct tini_ctx *ctx, const struct tini *node,
 		const char *msg,
 		enum tini_result code);
 
+extern void
+tini_add_error_arg(struct tini_ctx *ctx, const struct tini *node,
+		const char *arg,
+		enum tini_result code);
+
+enum tini_format
+{
+	TINI_FORMAT_TEXT,
+	TINI_FORMAT_COLOR,
+	TINI_FORMAT_JSON,
+	TINI_FORMAT_SARIF,
+};
+
+/**
+ * Renders diagnostics into a caller buffer so they can be written at once.
+ * Like `snprintf`, rendering continues counting past the end of the buffer,
+ * and `tini_render_end` returns the total length needed. JSON output is one
+ * object per line; SARIF output is a single log wrapping every rendered
+ * result between `tini_render_begin` and `tini_render_end`.
+ */
+struct tini_render
+{
+	char *buf;
+	size_t len;
+	size_t pos;
+	enum tini_format format;
+	unsigned count;
+};
+
+extern void
+tini_render_begin(struct tini_render *r, enum tini_format format,
+		char *buf, size_t len);
+
+extern size_t
+tini_render_end(struct tini_render *r);
+
+extern void
+tini_render_put(struct tini_render *r, const char *s, size_t n);
+
+extern void
+tini_render_node(struct tini_render *r, const struct tini_ctx *ctx,
+		const struct tini *node, const char *path,
+		enum tini_result code, const char *msg, const char *arg);
+
+extern void
+tini_render_errors(struct tini_render *r, const struct tini_ctx *ctx,
+		const char *path);
+
 extern void
 tini_print_errors(const struct tini_ctx *ctx,
 		const char *path, FILE *out);
 
+/**
+ * Returns the origin of the named field, or NULL if there is no such field
+ * or it was never set.
+ */
+extern const struct tini_origin *
+tini_origin_find(const struct tini_origin *origins,
+		const struct tini_field *fields, size_t nfields,
+		const char *name);
+
+#define tini_origin(_origins, _fields, _name) \
+	tini_origin_find((_origins), (_fields), \
+			sizeof(_fields) / sizeof((_fields)[0]), (_name))
+
+/**
+ * Prints a line for each field of a section that was set, naming the file
+ * (from `files` indexed by file ID, when given), line and layer of the value
+ * that won.
+ */
+extern void
+tini_print_origins(const char *section,
+		const struct tini_origin *origins,
+		const struct tini_field *fields, size_t nfields,
+		const char *const *files, FILE *out);
+
 extern void __attribute__ ((format (printf, 5, 6)))
 tini_errorf(const struct tini_ctx *ctx, const struct tini *node,
 		const char *path, FILE *out,
 		const char *fmt, ...);
 
+enum tini_json_format
+{
+	TINI_JSON_OBJECT,
+	TINI_JSON_LINES,
+};
+
+/**
+ * Streams parse events as JSON through a caller buffer, which is passed to
+ * `write` whenever it fills. A non-zero return from `write` stops the output.
+ *
+ * In object form, keys before the first section are members of the top-level
+ * object and each section is a nested object named `name` or `name:label`.
+ * Sections are written in document order, so a repeated section appears more
+ * than once. In lines form, each value is written as a separate object with
+ * its section, label and key.
+ *
+ * Values are strings unless the context has a `load_section` callback; then
+ * the fields of each section give the type, and booleans and numeric fields
+ * are written as JSON literals. Text may be fed in pieces that each end on a
+ * line boundary, and memory use is bounded by the buffer and the longest
+ * section header.
+ */
+struct tini_json
+{
+	char *buf;
+	size_t len;
+	size_t pos;
+	int (*write)(const char *buf, size_t len, void *udata);
+	void *udata;
+	enum tini_json_format format;
+	struct tini_section section;
+	unsigned count;
+	unsigned nested;
+	bool loaded;
+	bool open;
+	bool labelled;
+	bool failed;
+	char *name;
+	size_t namelen;
+	size_t labellen;
+	size_t namecap;
+};
+
+extern void
+tini_json_begin(struct tini_json *j, enum tini_json_format format,
+		char *buf, size_t len,
+		int (*write)(const char *buf, size_t len, void *udata),
+		void *udata);
+
+extern enum tini_result
+tini_json_feed(struct tini_json *j, struct tini_ctx *ctx,
+		const char *txt, size_t txtlen,
+		int flags);
+
+extern enum tini_result
+tini_json_end(struct tini_json *j);
+
 extern const char *
 tini_msg(enum tini_result rc);
 
@@ -188,6 +1056,13 @@ extern enum tini_result
 tini_set(void *target, size_t size, enum tini_type type,
 		const struct tini *value);
 
+/**
+ * Adds the characters in `spec` to the check's character set. A `-` between
+ * two characters adds the range between them.
+ */
+extern void
+tini_check_charset(struct tini_check *check, const char *spec);
+
 extern enum tini_result
 tini_set_field(void *target,
 		const struct tini_field *field,
@@ -199,5 +1074,16 @@ tini_assign(const struct tini_section *section,
 		const struct tini *value,
 		void *udata);
 
+extern size_t
+tini_assign_batch(const struct tini_section *section,
+		struct tini_pair *pairs,
+		size_t n,
+		void *udata);
+
+#ifdef __cplusplus
+}
+# undef tini
+#endif
+
 #endif
 
@@ -0,0 +1,733 @@
+#ifndef TINI_HPP
+#define TINI_HPP
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <sys/types.h>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+# include <coroutine>
+# include <iterator>
+# include <new>
+# include <ranges>
+#endif
+
+#include "tini.h"
+
+/**
+ * The C API is declared at global scope, where C++ sees `struct tini` as
+ * `struct tini_node` so it does not collide with the `tini` namespace. Its
+ * names are brought into `tini::c`, with `c::tini` for the value node, so
+ * tini.h may be included before or after this header. Names added to tini.h
+ * are listed here as well.
+ */
+namespace tini {
+namespace c {
+
+using tini = ::tini_node;
+
+using ::tini_span, ::tini_error, ::tini_phash, ::tini_enum_value,
+	::tini_enum, ::tini_check, ::tini_field, ::tini_pair, ::tini_origin,
+	::tini_section, ::tini_schema_section, ::tini_schema, ::tini_collection,
+	::tini_interned, ::tini_intern, ::tini_ctx, ::tini_batch, ::tini_event,
+	::tini_iter, ::tini_shm_control, ::tini_shm, ::tini_shm_view,
+	::tini_render, ::tini_json, ::tini_stream, ::tini_overlay;
+
+using ::tini_result, ::tini_flag, ::tini_batch_option, ::tini_field_flag,
+	::tini_type, ::tini_check_mask, ::tini_event_type, ::tini_format,
+	::tini_json_format;
+
+using ::TINI_SUCCESS, ::TINI_SYNTAX, ::TINI_STRING_TOO_BIG,
+	::TINI_BOOL_FORMAT, ::TINI_INTEGER_FORMAT, ::TINI_INTEGER_TOO_SMALL,
+	::TINI_INTEGER_TOO_BIG, ::TINI_INTEGER_NEGATIVE, ::TINI_NUMBER_FORMAT,
+	::TINI_INVALID_TYPE, ::TINI_UNUSED_SECTION, ::TINI_UNUSED_KEY,
+	::TINI_MISSING_SECTION, ::TINI_MISSING_KEY, ::TINI_ENUM_UNKNOWN,
+	::TINI_DURATION_FORMAT, ::TINI_DURATION_TOO_BIG, ::TINI_SIZE_FORMAT,
+	::TINI_SIZE_TOO_BIG, ::TINI_TIME_FORMAT, ::TINI_TIME_RANGE,
+	::TINI_DUPLICATE_KEY, ::TINI_REQUIRED_KEY, ::TINI_VALUE_TOO_SMALL,
+	::TINI_VALUE_TOO_BIG, ::TINI_LENGTH_TOO_SHORT, ::TINI_LENGTH_TOO_LONG,
+	::TINI_VALUE_PATTERN, ::TINI_MISSING_PARENT, ::TINI_INHERIT_CYCLE,
+	::TINI_INVALID_UTF8, ::TINI_CONTROL_CHAR, ::TINI_OUTPUT_ERROR,
+	::TINI_NO_MEMORY, ::TINI_DENY_DUPLICATES, ::TINI_BATCH, ::TINI_INHERIT,
+	::TINI_VALIDATE, ::TINI_RECOVER, ::TINI_MULTILINE, ::TINI_BATCH_SYNC,
+	::TINI_REQUIRED, ::TINI_NONE, ::TINI_SECTION, ::TINI_LABEL, ::TINI_KEY,
+	::TINI_VALUE, ::TINI_STRING, ::TINI_BOOL, ::TINI_SIGNED,
+	::TINI_UNSIGNED, ::TINI_NUMBER, ::TINI_NODE, ::TINI_ENUM, ::TINI_FLAGS,
+	::TINI_DURATION, ::TINI_SIZE, ::TINI_TIME, ::TINI_CONTINUED,
+	::TINI_CHECK_RANGE, ::TINI_CHECK_LENGTH, ::TINI_CHECK_CHARSET,
+	::TINI_EVENT_NONE, ::TINI_EVENT_SECTION, ::TINI_EVENT_VALUE,
+	::TINI_EVENT_ERROR, ::TINI_FORMAT_TEXT, ::TINI_FORMAT_COLOR,
+	::TINI_FORMAT_JSON, ::TINI_FORMAT_SARIF, ::TINI_JSON_OBJECT,
+	::TINI_JSON_LINES;
+
+using ::tini_span_make, ::tini_span_node, ::tini_collection_load,
+	::tini_collection_at, ::tini_collection_label, ::tini_collection_find,
+	::tini_collection_free, ::tini_intern_get, ::tini_iter_init,
+	::tini_next, ::tini_iter_recover, ::tini_validate, ::tini_locate,
+	::tini_ctx_locate, ::tini_stream_open, ::tini_stream_next,
+	::tini_stream_parse, ::tini_stream_close, ::tini_parse,
+	::tini_parse_into, ::tini_patch, ::tini_patch_into, ::tini_batch_load,
+	::tini_overlay_new, ::tini_overlay_free, ::tini_overlay_set,
+	::tini_overlay_get, ::tini_overlay_bind, ::tini_shm_init,
+	::tini_shm_free, ::tini_shm_publish, ::tini_shm_attach,
+	::tini_shm_detach, ::tini_shm_generation, ::tini_eq, ::tini_segment,
+	::tini_length, ::tini_str, ::tini_int, ::tini_bool, ::tini_double,
+	::tini_duration, ::tini_size, ::tini_time, ::tini_copy,
+	::tini_enum_compile, ::tini_enum_free, ::tini_enum_find, ::tini_intern,
+	::tini_intern_value, ::tini_intern_find, ::tini_intern_free,
+	::tini_schema_compile, ::tini_schema_free, ::tini_schema_find,
+	::tini_enum_parse, ::tini_flags_parse, ::tini_error_node,
+	::tini_add_error, ::tini_add_error_arg, ::tini_render_begin,
+	::tini_render_end, ::tini_render_put, ::tini_render_node,
+	::tini_render_errors, ::tini_print_errors, ::tini_origin_find,
+	::tini_print_origins, ::tini_errorf, ::tini_json_begin,
+	::tini_json_feed, ::tini_json_end, ::tini_msg, ::tini_field_find,
+	::tini_set, ::tini_check_charset, ::tini_set_field, ::tini_assign,
+	::tini_assign_batch;
+
+} // namespace c
+
+using node = c::tini;
+using ctx = c::tini_ctx;
+using result = c::tini_result;
+
+inline std::string_view
+view(const node &n) noexcept
+{
+	return std::string_view(n.start, n.length);
+}
+
+/**
+ * Converts a value node into a `T`. Specialize this for application types;
+ * each specialization provides `static result apply(T &, const node &)`.
+ */
+template <class T, class Enable = void>
+struct convert;
+
+template <>
+struct convert<bool>
+{
+	static result apply(bool &out, const node &v) noexcept
+	{
+		return c::tini_bool(&out, &v);
+	}
+};
+
+template <class T>
+struct convert<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+{
+	static result apply(T &out, const node &v) noexcept
+	{
+		const char *p = v.start, *pe = p + v.length;
+		bool neg = false;
+		int base = 10;
+		if (p < pe && (*p == '-' || *p == '+')) {
+			neg = *p++ == '-';
+		}
+		if (pe - p > 1 && p[0] == '0') {
+			if (p[1] == 'x' || p[1] == 'X') { base = 16; p += 2; }
+			else { base = 8; p++; }
+		}
+
+		uint64_t mag;
+		auto [end, ec] = std::from_chars(p, pe, mag, base);
+		if (p == pe || end != pe) {
+			return c::TINI_INTEGER_FORMAT;
+		}
+		if (ec == std::errc::result_out_of_range) {
+			return neg && std::is_signed_v<T> ?
+				c::TINI_INTEGER_TOO_SMALL : c::TINI_INTEGER_TOO_BIG;
+		}
+
+		using U = std::make_unsigned_t<T>;
+		constexpr uint64_t max = static_cast<U>(std::numeric_limits<T>::max());
+		if constexpr (std::is_signed_v<T>) {
+			if (neg) {
+				if (mag > max + 1) { return c::TINI_INTEGER_TOO_SMALL; }
+				out = static_cast<T>(static_cast<U>(0 - mag));
+				return c::TINI_SUCCESS;
+			}
+		}
+		else if (neg && mag != 0) {
+			return c::TINI_INTEGER_NEGATIVE;
+		}
+		if (mag > max) { return c::TINI_INTEGER_TOO_BIG; }
+		out = static_cast<T>(mag);
+		return c::TINI_SUCCESS;
+	}
+};
+
+template <class T>
+struct convert<T, std::enable_if_t<std::is_floating_point_v<T>>>
+{
+	static result apply(T &out, const node &v) noexcept
+	{
+		auto [end, ec] = std::from_chars(v.start, v.start + v.length, out);
+		if (ec != std::errc() || end != v.start + v.length) {
+			return c::TINI_NUMBER_FORMAT;
+		}
+		return c::TINI_SUCCESS;
+	}
+};
+
+template <std::size_t N>
+struct convert<char[N]>
+{
+	static result apply(char (&out)[N], const node &v) noexcept
+	{
+		return c::tini_str(out, N, &v);
+	}
+};
+
+template <>
+struct convert<std::string>
+{
+	static result apply(std::string &out, const node &v)
+	{
+		out.assign(v.start, v.length);
+		return c::TINI_SUCCESS;
+	}
+};
+
+template <>
+struct convert<std::string_view>
+{
+	static result apply(std::string_view &out, const node &v) noexcept
+	{
+		out = view(v);
+		return c::TINI_SUCCESS;
+	}
+};
+
+template <>
+struct convert<node>
+{
+	static result apply(node &out, const node &v) noexcept
+	{
+		out = v;
+		return c::TINI_SUCCESS;
+	}
+};
+
+template <class Rep, class Period>
+struct convert<std::chrono::duration<Rep, Period>>
+{
+	static result apply(std::chrono::duration<Rep, Period> &out, const node &v) noexcept
+	{
+		int64_t ns;
+		result rc = c::tini_duration(&ns, &v);
+		if (rc == c::TINI_SUCCESS) {
+			out = std::chrono::duration_cast<std::chrono::duration<Rep, Period>>(
+					std::chrono::nanoseconds(ns));
+		}
+		return rc;
+	}
+};
+
+namespace detail {
+
+template <class M>
+struct member_traits;
+
+template <class C, class T>
+struct member_traits<T C::*>
+{
+	using class_type = C;
+	using type = T;
+};
+
+constexpr uint64_t
+hash(std::string_view s, uint64_t seed) noexcept
+{
+	// must match tini_hash in src/phash.h
+	uint64_t h = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+	for (char ch : s) {
+		h ^= static_cast<uint8_t>(ch);
+		h *= 0x100000001b3ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+constexpr std::size_t
+table_size(std::size_t n) noexcept
+{
+	std::size_t m = 2;
+	while (m < n + n/4) { m <<= 1; }
+	return m;
+}
+
+/**
+ * Compile-time hash-and-displace table over `N` names. Lookups cost two
+ * hashes and one comparison.
+ */
+template <std::size_t N>
+struct key_table
+{
+	static constexpr std::size_t M = table_size(N);
+	static constexpr uint32_t empty = UINT32_MAX;
+
+	std::array<std::string_view, N> names{};
+	std::array<int32_t, N ? N : 1> disp{};
+	std::array<uint32_t, M> slots{};
+
+	constexpr explicit key_table(const std::array<std::string_view, N> &n)
+		: names(n)
+	{
+		for (auto &s : slots) { s = empty; }
+		if constexpr (N > 0) { build(); }
+	}
+
+	constexpr void build()
+	{
+		std::array<uint32_t, N> bucket{};
+		std::array<uint32_t, N> size{};
+		for (std::size_t i = 0; i < N; i++) {
+			bucket[i] = hash(names[i], 0) % N;
+			size[bucket[i]]++;
+		}
+
+		std::size_t maxsz = 0;
+		for (auto sz : size) { if (sz > maxsz) { maxsz = sz; } }
+
+		uint32_t free_slot = 0;
+		for (std::size_t sz = maxsz; sz > 0; sz--) {
+			for (std::size_t b = 0; b < N; b++) {
+				if (size[b] != sz) { continue; }
+
+				std::array<uint32_t, N> keys{};
+				std::size_t nkeys = 0;
+				for (std::size_t i = 0; i < N; i++) {
+					if (bucket[i] == b) { keys[nkeys++] = i; }
+				}
+
+				if (sz == 1) {
+					while (slots[free_slot] != empty) { free_slot++; }
+					slots[free_slot] = keys[0];
+					disp[b] = -static_cast<int32_t>(free_slot) - 1;
+					continue;
+				}
+
+				for (std::size_t i = 0; i < nkeys; i++) {
+					for (std::size_t j = i + 1; j < nkeys; j++) {
+						if (names[keys[i]] == names[keys[j]]) {
+							throw "duplicate name in tini schema";
+						}
+					}
+				}
+
+				for (uint32_t d = 1;; d++) {
+					std::array<uint32_t, N> pos{};
+					std::size_t i = 0;
+					for (; i < nkeys; i++) {
+						pos[i] = hash(names[keys[i]], d) & (M - 1);
+						if (slots[pos[i]] != empty) { break; }
+						slots[pos[i]] = keys[i];
+					}
+					if (i == nkeys) {
+						disp[b] = static_cast<int32_t>(d);
+						break;
+					}
+					while (i > 0) { i--; slots[pos[i]] = empty; }
+				}
+			}
+		}
+	}
+
+	constexpr int find(std::string_view key) const noexcept
+	{
+		if constexpr (N == 0) {
+			return -1;
+		}
+		else {
+			int32_t d = disp[hash(key, 0) % N];
+			if (d == 0) { return -1; }
+			uint32_t p = d < 0 ?
+				static_cast<uint32_t>(-(d + 1)) :
+				static_cast<uint32_t>(hash(key, d) & (M - 1));
+			uint32_t idx = slots[p];
+			return idx != empty && names[idx] == key ? static_cast<int>(idx) : -1;
+		}
+	}
+};
+
+} // namespace detail
+
+/**
+ * Binds the key `name` to a data member.
+ */
+template <auto Member>
+struct field
+{
+	using traits = detail::member_traits<decltype(Member)>;
+	using class_type = typename traits::class_type;
+	using type = typename traits::type;
+	static constexpr auto member = Member;
+	static constexpr bool is_section = false;
+
+	std::string_view name;
+
+	constexpr explicit field(std::string_view n) noexcept : name(n) {}
+};
+
+/**
+ * Binds the section `[name]` to a data member described by `Fields`.
+ */
+template <auto Member, const auto &Fields>
+struct section
+{
+	using traits = detail::member_traits<decltype(Member)>;
+	using class_type = typename traits::class_type;
+	using type = typename traits::type;
+	static constexpr auto member = Member;
+	static constexpr const auto &fields = Fields;
+	static constexpr bool is_section = true;
+
+	std::string_view name;
+
+	constexpr explicit section(std::string_view n) noexcept : name(n) {}
+};
+
+/**
+ * A compile-time table of fields and sections for one struct.
+ */
+template <class... E>
+struct fields
+{
+	static constexpr std::size_t size = sizeof...(E);
+
+	std::tuple<E...> entries;
+	detail::key_table<size> table;
+	std::array<bool, size> sections{ E::is_section... };
+
+	constexpr fields(E... e)
+		: entries(e...)
+		, table(std::array<std::string_view, size>{ e.name... })
+	{
+	}
+
+	constexpr int find(std::string_view key) const noexcept
+	{
+		return table.find(key);
+	}
+
+	/**
+	 * Invokes `fn` with the entry at runtime index `idx`. This expands to a
+	 * chain of direct calls rather than a table of function pointers.
+	 */
+	template <class Fn>
+	constexpr result visit(int idx, Fn &&fn) const
+	{
+		return visit(idx, fn, std::index_sequence_for<E...>{});
+	}
+
+private:
+	template <class Fn, std::size_t... I>
+	constexpr result visit(int idx, Fn &fn, std::index_sequence<I...>) const
+	{
+		result rc = c::TINI_MISSING_KEY;
+		(void)((idx == static_cast<int>(I) ?
+					(rc = fn(std::get<I>(entries)), true) : false) || ...);
+		return rc;
+	}
+};
+
+template <class... E>
+fields(E...) -> fields<E...>;
+
+namespace detail {
+
+template <const auto &Fields, class T>
+result
+assign(T &target, const node &key, const node &value)
+{
+	int idx = Fields.find(view(key));
+	if (idx < 0 || Fields.sections[idx]) {
+		return c::TINI_MISSING_KEY;
+	}
+	return Fields.visit(idx, [&](const auto &entry) -> result {
+		using E = std::decay_t<decltype(entry)>;
+		if constexpr (E::is_section) {
+			return c::TINI_MISSING_KEY;
+		}
+		else {
+			return convert<typename E::type>::apply(target.*E::member, value);
+		}
+	});
+}
+
+template <const auto &Fields, class T>
+result
+assign_section(T &target, int section, const node &key, const node &value)
+{
+	if (section < 0) {
+		return assign<Fields>(target, key, value);
+	}
+	return Fields.visit(section, [&](const auto &entry) -> result {
+		using E = std::decay_t<decltype(entry)>;
+		if constexpr (E::is_section) {
+			return assign<E::fields>(target.*E::member, key, value);
+		}
+		else {
+			return c::TINI_MISSING_KEY;
+		}
+	});
+}
+
+} // namespace detail
+
+/**
+ * Parses `txt` into `target` using the schema `Fields`. This drives
+ * `tini_next` directly, so every section and key is dispatched through
+ * inlined code rather than the `load_section` and `assign` callbacks. Errors
+ * are collected in `ctx` exactly as they are for `tini_parse`.
+ */
+template <const auto &Fields, class T>
+result
+load(T &target, ctx &ctx, std::string_view txt)
+{
+	c::tini_iter it;
+	c::tini_event ev;
+	int section = -1;
+	bool bound = true;
+
+	ctx.txt = txt.data();
+	ctx.txtlen = txt.size();
+	ctx.txtline = 0;
+	ctx.nerr = 0;
+	ctx.cursor = nullptr;
+
+	c::tini_iter_init(&it, txt.data(), txt.size());
+	while (c::tini_next(&it, &ev)) {
+		switch (ev.type) {
+		case c::TINI_EVENT_SECTION:
+			section = Fields.find(view(ev.name));
+			bound = section >= 0 && Fields.sections[section];
+			if (!bound) {
+				c::tini_add_error(&ctx, &ev.name, nullptr, c::TINI_MISSING_SECTION);
+			}
+			break;
+		case c::TINI_EVENT_VALUE: {
+			result rc = bound ?
+				detail::assign_section<Fields>(target, section, ev.name, ev.value) :
+				c::TINI_MISSING_KEY;
+			if (rc != c::TINI_SUCCESS) {
+				c::tini_add_error(&ctx, c::tini_error_node(&ev.name, &ev.value, rc),
+						nullptr, rc);
+			}
+			break;
+		}
+		case c::TINI_EVENT_ERROR:
+			c::tini_add_error(&ctx, &ev.name, nullptr, ev.code);
+			break;
+		case c::TINI_EVENT_NONE:
+			break;
+		}
+	}
+
+	return ctx.nerr ? ctx.err[0].code : c::TINI_SUCCESS;
+}
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+using event = c::tini_event;
+
+namespace detail {
+
+/**
+ * Recycles coroutine frames on each thread, so only the first generator
+ * created on a thread allocates from the heap.
+ */
+class frame_cache
+{
+	struct block
+	{
+		block *next;
+		std::size_t size;
+	};
+
+	static constexpr std::size_t max_blocks = 8;
+
+	block *head = nullptr;
+	std::size_t count = 0;
+
+public:
+	frame_cache() = default;
+	frame_cache(const frame_cache &) = delete;
+	frame_cache &operator=(const frame_cache &) = delete;
+
+	~frame_cache()
+	{
+		while (head) {
+			block *b = head;
+			head = b->next;
+			::operator delete(b, b->size);
+		}
+	}
+
+	void *allocate(std::size_t n)
+	{
+		for (block **b = &head; *b; b = &(*b)->next) {
+			if ((*b)->size == n) {
+				block *hit = *b;
+				*b = hit->next;
+				count--;
+				return hit;
+			}
+		}
+		return ::operator new(n < sizeof(block) ? sizeof(block) : n);
+	}
+
+	void deallocate(void *p, std::size_t n) noexcept
+	{
+		if (count == max_blocks || n < sizeof(block)) {
+			::operator delete(p, n < sizeof(block) ? sizeof(block) : n);
+			return;
+		}
+		head = new (p) block{ head, n };
+		count++;
+	}
+
+	static frame_cache &local() noexcept
+	{
+		thread_local frame_cache cache;
+		return cache;
+	}
+};
+
+} // namespace detail
+
+/**
+ * A lazy, move-only input range of parse events. The parser runs only when
+ * the range is advanced, one event (one line) at a time.
+ */
+class event_generator : public std::ranges::view_base
+{
+public:
+	struct promise_type
+	{
+		const event *current = nullptr;
+
+		event_generator get_return_object() noexcept
+		{
+			return event_generator{ handle::from_promise(*this) };
+		}
+
+		std::suspend_always initial_suspend() const noexcept { return {}; }
+		std::suspend_always final_suspend() const noexcept { return {}; }
+
+		std::suspend_always yield_value(const event &ev) noexcept
+		{
+			current = &ev;
+			return {};
+		}
+
+		void return_void() const noexcept {}
+		void unhandled_exception() const { throw; }
+
+		static void *operator new(std::size_t n)
+		{
+			return detail::frame_cache::local().allocate(n);
+		}
+
+		static void operator delete(void *p, std::size_t n) noexcept
+		{
+			detail::frame_cache::local().deallocate(p, n);
+		}
+	};
+
+	using handle = std::coroutine_handle<promise_type>;
+
+	class iterator
+	{
+	public:
+		using value_type = event;
+		using difference_type = std::ptrdiff_t;
+
+		iterator() = default;
+		explicit iterator(handle h) noexcept : h(h) {}
+
+		const event &operator*() const noexcept { return *h.promise().current; }
+		const event *operator->() const noexcept { return h.promise().current; }
+
+		iterator &operator++()
+		{
+			h.resume();
+			return *this;
+		}
+
+		void operator++(int) { ++*this; }
+
+		friend bool operator==(const iterator &it, std::default_sentinel_t) noexcept
+		{
+			return !it.h || it.h.done();
+		}
+
+	private:
+		handle h;
+	};
+
+	event_generator() = default;
+	event_generator(event_generator &&other) noexcept : h(std::exchange(other.h, {})) {}
+
+	event_generator &operator=(event_generator &&other) noexcept
+	{
+		if (this != &other) {
+			if (h) { h.destroy(); }
+			h = std::exchange(other.h, {});
+		}
+		return *this;
+	}
+
+	~event_generator()
+	{
+		if (h) { h.destroy(); }
+	}
+
+	iterator begin()
+	{
+		if (h) { h.resume(); }
+		return iterator{ h };
+	}
+
+	std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+	explicit event_generator(handle h) noexcept : h(h) {}
+
+	handle h;
+};
+
+/**
+ * Returns a generator over the section, key/value and error events in `buf`.
+ * The buffer must outlive the generator and every event it yields.
+ */
+inline event_generator
+events(std::string_view buf)
+{
+	c::tini_iter it;
+	c::tini_event ev;
+	c::tini_iter_init(&it, buf.data(), buf.size());
+	while (c::tini_next(&it, &ev)) {
+		co_yield ev;
+	}
+}
+
+#endif
+
+} // namespace tini
+
+#endif
@@ -0,0 +1,677 @@
+#include "../include/tini.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <linux/io_uring.h>
+# define HAVE_URING 1
+#endif
+
+#define DEPTH_DEFAULT 64
+#define READ_MAX (1u << 30)
+
+enum op
+{
+	OP_OPEN,
+	OP_STAT,
+	OP_READ,
+	OP_CLOSE,
+};
+
+#define UDATA(slot, op) (((uint64_t)(slot) << 2) | (op))
+#define UDATA_SLOT(u) ((size_t)((u) >> 2))
+#define UDATA_OP(u) ((enum op)((u) & 3))
+#define UDATA_CANCEL UINT64_MAX
+
+/**
+ * A file in flight. Slots are recycled along with their read buffer and
+ * context, so a batch allocates `depth` buffers no matter how many files it
+ * loads.
+ */
+struct slot
+{
+	struct tini_ctx ctx;
+	char *buf;
+	size_t cap;
+	size_t len;
+	size_t size;
+	size_t index;
+	int fd;
+	int err;
+	unsigned pending;
+	bool io;
+#ifdef HAVE_URING
+	struct statx stx;
+#endif
+};
+
+#ifdef HAVE_URING
+
+/**
+ * A minimal io_uring driven through the raw system calls.
+ */
+struct ring
+{
+	int fd;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	unsigned sq_entries;
+	unsigned queued;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ptr, *cq_ptr;
+	size_t sq_len, cq_len, sqes_len;
+};
+
+static const uint8_t ring_ops[] = {
+	IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE,
+};
+
+static bool
+ring_probe(int fd)
+{
+	size_t n = 64;
+	struct io_uring_probe *probe =
+		calloc(1, sizeof(*probe) + n*sizeof(probe->ops[0]));
+	if (probe == NULL) { return false; }
+
+	bool ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, n) == 0;
+	for (size_t i = 0; ok && i < sizeof(ring_ops); i++) {
+		ok = ring_ops[i] <= probe->last_op &&
+			(probe->ops[ring_ops[i]].flags & IO_URING_OP_SUPPORTED);
+	}
+	free(probe);
+	return ok;
+}
+
+static void
+ring_free(struct ring *r)
+{
+	if (r->sqes) { munmap(r->sqes, r->sqes_len); }
+	if (r->cq_ptr && r->cq_ptr != r->sq_ptr) { munmap(r->cq_ptr, r->cq_len); }
+	if (r->sq_ptr) { munmap(r->sq_ptr, r->sq_len); }
+	if (r->fd >= 0) { close(r->fd); }
+	*r = (struct ring){ .fd = -1 };
+}
+
+static int
+ring_init(struct ring *r, unsigned entries)
+{
+	struct io_uring_params p = { 0 };
+
+	*r = (struct ring){ .fd = -1 };
+	r->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (r->fd < 0 || !ring_probe(r->fd)) {
+		goto error;
+	}
+
+	r->sq_len = p.sq_off.array + p.sq_entries*sizeof(unsigned);
+	r->cq_len = p.cq_off.cqes + p.cq_entries*sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_len > r->sq_len) { r->sq_len = r->cq_len; }
+		r->cq_len = r->sq_len;
+	}
+
+	r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ|PROT_WRITE,
+			MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ptr == MAP_FAILED) { r->sq_ptr = NULL; goto error; }
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_ptr = r->sq_ptr;
+	}
+	else {
+		r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ|PROT_WRITE,
+				MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_ptr == MAP_FAILED) { r->cq_ptr = NULL; goto error; }
+	}
+
+	r->sqes_len = p.sq_entries*sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_len, PROT_READ|PROT_WRITE,
+			MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) { r->sqes = NULL; goto error; }
+
+	char *sq = r->sq_ptr, *cq = r->cq_ptr;
+	r->sq_head = (unsigned *)(sq + p.sq_off.head);
+	r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+	r->sq_array = (unsigned *)(sq + p.sq_off.array);
+	r->sq_entries = p.sq_entries;
+	r->cq_head = (unsigned *)(cq + p.cq_off.head);
+	r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	return 0;
+
+error:
+	ring_free(r);
+	return -1;
+}
+
+static int
+ring_enter(struct ring *r, unsigned wait)
+{
+	for (;;) {
+		int rc = syscall(__NR_io_uring_enter, r->fd, r->queued, wait,
+				wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (rc >= 0) {
+			r->queued -= rc;
+			return 0;
+		}
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+			return -1;
+		}
+		// the kernel is out of resources for new submissions, so reap first
+		if (errno != EINTR && wait == 0) { wait = 1; }
+	}
+}
+
+static int
+ring_push(struct ring *r, const struct io_uring_sqe *sqe)
+{
+	unsigned tail = *r->sq_tail;
+	while (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) == r->sq_entries) {
+		if (ring_enter(r, 0) < 0) { return -1; }
+	}
+	unsigned idx = tail & *r->sq_mask;
+	r->sqes[idx] = *sqe;
+	r->sq_array[idx] = idx;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	r->queued++;
+	return 0;
+}
+
+#endif
+
+/**
+ * Shared state of a batch. The mutex guards the work queue, the free list
+ * and the finished count; everything else belongs to the I/O thread.
+ */
+struct loader
+{
+	const struct tini_batch *batch;
+	struct slot *slots;
+	size_t nslots;
+	size_t next;
+	size_t inflight;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t freed;
+	size_t *free;
+	size_t nfree;
+	size_t *queue;
+	size_t qhead, qlen;
+	size_t finished;
+	bool stop;
+	bool abort;
+
+	pthread_t *workers;
+	unsigned nworkers;
+
+#ifdef HAVE_URING
+	struct ring ring;
+	bool uring;
+#endif
+};
+
+static int
+slot_reserve(struct slot *s, size_t size)
+{
+	if (size >= s->cap) {
+		size_t cap = s->cap ? s->cap : 4096;
+		while (cap <= size) { cap *= 2; }
+		char *buf = realloc(s->buf, cap);
+		if (buf == NULL) { return ENOMEM; }
+		s->buf = buf;
+		s->cap = cap;
+	}
+	return 0;
+}
+
+/**
+ * Parses a slot that finished reading (or failed to) and reports it.
+ */
+static void
+slot_parse(struct loader *l, struct slot *s)
+{
+	const struct tini_batch *b = l->batch;
+	enum tini_result rc = TINI_SUCCESS;
+
+	s->ctx = (struct tini_ctx)tini_ctx_make(b->load_section,
+			b->begin ? b->begin(s->index, b->udata) : b->udata);
+	if (s->err == 0) {
+		s->buf[s->len] = '\0';
+		rc = tini_parse(&s->ctx, s->buf, s->len, b->flags);
+	}
+	b->done(&s->ctx, s->index, s->err, rc, b->udata);
+}
+
+static void
+slot_release(struct loader *l, struct slot *s)
+{
+	pthread_mutex_lock(&l->lock);
+	l->free[l->nfree++] = s - l->slots;
+	l->finished++;
+	pthread_cond_signal(&l->freed);
+	pthread_mutex_unlock(&l->lock);
+}
+
+/**
+ * Hands a slot that is done with I/O to the worker pool.
+ */
+static void
+slot_dispatch(struct loader *l, struct slot *s)
+{
+	s->io = false;
+	if (l->nworkers == 0) {
+		slot_parse(l, s);
+		slot_release(l, s);
+		return;
+	}
+
+	pthread_mutex_lock(&l->lock);
+	l->queue[(l->qhead + l->qlen++) % l->nslots] = s - l->slots;
+	pthread_cond_signal(&l->work);
+	pthread_mutex_unlock(&l->lock);
+}
+
+static void *
+worker(void *arg)
+{
+	struct loader *l = arg;
+
+	pthread_mutex_lock(&l->lock);
+	for (;;) {
+		while (l->qlen == 0 && !l->stop) {
+			pthread_cond_wait(&l->work, &l->lock);
+		}
+		if (l->qlen == 0) { break; }
+
+		struct slot *s = &l->slots[l->queue[l->qhead]];
+		l->qhead = (l->qhead + 1) % l->nslots;
+		l->qlen--;
+		pthread_mutex_unlock(&l->lock);
+
+		slot_parse(l, s);
+
+		pthread_mutex_lock(&l->lock);
+		l->free[l->nfree++] = s - l->slots;
+		l->finished++;
+		pthread_cond_signal(&l->freed);
+	}
+	pthread_mutex_unlock(&l->lock);
+	return NULL;
+}
+
+/**
+ * Reads a whole file with plain system calls.
+ */
+static void
+sync_load(struct loader *l, struct slot *s, const char *path)
+{
+	struct stat st;
+	int fd = open(path, O_RDONLY|O_CLOEXEC);
+
+	s->len = 0;
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		s->err = errno;
+	}
+	else if ((s->err = slot_reserve(s, st.st_size)) == 0) {
+		while (s->len < (size_t)st.st_size) {
+			ssize_t n = read(fd, s->buf + s->len, st.st_size - s->len);
+			if (n < 0 && errno == EINTR) { continue; }
+			if (n < 0) { s->err = errno; break; }
+			if (n == 0) { break; }
+			s->len += n;
+		}
+	}
+	if (fd >= 0) { close(fd); }
+	slot_dispatch(l, s);
+}
+
+#ifdef HAVE_URING
+
+static int
+uring_submit(struct loader *l, struct slot *s, enum op op)
+{
+	struct io_uring_sqe sqe = {
+		.opcode = ring_ops[op],
+		.user_data = UDATA(s - l->slots, op),
+	};
+	const char *path = l->batch->paths[s->index];
+
+	switch (op) {
+	case OP_OPEN:
+		sqe.fd = AT_FDCWD;
+		sqe.addr = (uintptr_t)path;
+		sqe.open_flags = O_RDONLY|O_CLOEXEC;
+		break;
+	case OP_STAT:
+		sqe.fd = AT_FDCWD;
+		sqe.addr = (uintptr_t)path;
+		sqe.len = STATX_SIZE;
+		sqe.off = (uintptr_t)&s->stx;
+		break;
+	case OP_READ:
+		sqe.fd = s->fd;
+		sqe.addr = (uintptr_t)(s->buf + s->len);
+		sqe.len = s->size - s->len > READ_MAX ? READ_MAX : s->size - s->len;
+		sqe.off = s->len;
+		break;
+	case OP_CLOSE:
+		sqe.fd = s->fd;
+		break;
+	}
+
+	if (ring_push(&l->ring, &sqe) < 0) {
+		return -1;
+	}
+	if (op == OP_CLOSE) { s->fd = -1; }
+	l->inflight++;
+	return 0;
+}
+
+/**
+ * Finishes I/O on a slot: closes the file without waiting and hands the
+ * slot to the workers.
+ */
+static int
+uring_finish(struct loader *l, struct slot *s)
+{
+	if (s->fd >= 0 && uring_submit(l, s, OP_CLOSE) < 0) {
+		return -1;
+	}
+	slot_dispatch(l, s);
+	return 0;
+}
+
+static int
+uring_complete(struct loader *l, const struct io_uring_cqe *cqe)
+{
+	l->inflight--;
+	if (cqe->user_data == UDATA_CANCEL) {
+		return 0;
+	}
+
+	enum op op = UDATA_OP(cqe->user_data);
+	struct slot *s = &l->slots[UDATA_SLOT(cqe->user_data)];
+	int res = cqe->res;
+
+	// after a failure, only keep what is needed to release the slot
+	if (l->abort) {
+		if (op == OP_OPEN && res >= 0) { s->fd = res; }
+		return 0;
+	}
+
+	switch (op) {
+	case OP_OPEN:
+	case OP_STAT:
+		if (res < 0 && s->err == 0) { s->err = -res; }
+		else if (op == OP_OPEN && res >= 0) { s->fd = res; }
+		if (--s->pending > 0) { return 0; }
+
+		// the open and statx have both completed
+		if (s->err == 0) {
+			s->size = s->stx.stx_size;
+			s->err = slot_reserve(s, s->size);
+		}
+		if (s->err || s->size == 0) {
+			return uring_finish(l, s);
+		}
+		return uring_submit(l, s, OP_READ);
+
+	case OP_READ:
+		if (res < 0) {
+			s->err = -res;
+			return uring_finish(l, s);
+		}
+		s->len += res;
+		if (res > 0 && s->len < s->size) {
+			return uring_submit(l, s, OP_READ);
+		}
+		return uring_finish(l, s);
+
+	case OP_CLOSE:
+		return 0;
+	}
+	return 0;
+}
+
+static int
+uring_reap(struct loader *l)
+{
+	struct ring *r = &l->ring;
+
+	if (ring_enter(r, 1) < 0) {
+		return -1;
+	}
+
+	unsigned head = *r->cq_head;
+	unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		struct io_uring_cqe cqe = r->cqes[head & *r->cq_mask];
+		__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+		if (uring_complete(l, &cqe) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Cancels the requests still in flight after the batch failed and waits for
+ * all of them to complete, so none writes into a buffer once it is freed.
+ * Cancelling a request that already finished is harmless. Returns -1 if the
+ * ring cannot be drained.
+ */
+static int
+uring_cancel(struct loader *l)
+{
+	l->abort = true;
+	for (size_t i = 0; i < l->nslots; i++) {
+		for (enum op op = OP_OPEN; l->slots[i].io && op <= OP_READ; op++) {
+			struct io_uring_sqe sqe = {
+				.opcode = IORING_OP_ASYNC_CANCEL,
+				.addr = UDATA(i, op),
+				.user_data = UDATA_CANCEL,
+			};
+			if (ring_push(&l->ring, &sqe) < 0) {
+				return -1;
+			}
+			l->inflight++;
+		}
+	}
+	while (l->inflight > 0) {
+		if (uring_reap(l) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+#endif
+
+static int
+start(struct loader *l, size_t idx)
+{
+	struct slot *s = &l->slots[idx];
+
+	s->index = l->next++;
+	s->len = 0;
+	s->size = 0;
+	s->err = 0;
+
+#ifdef HAVE_URING
+	if (l->uring) {
+		s->fd = -1;
+		s->pending = 2;
+		s->io = true;
+		if (uring_submit(l, s, OP_OPEN) < 0 || uring_submit(l, s, OP_STAT) < 0) {
+			return -1;
+		}
+		return 0;
+	}
+#endif
+
+	sync_load(l, s, l->batch->paths[s->index]);
+	return 0;
+}
+
+/**
+ * Runs the I/O side of the batch on the calling thread until every file has
+ * been reported.
+ */
+static int
+run(struct loader *l)
+{
+	size_t n = l->batch->npaths;
+
+	pthread_mutex_lock(&l->lock);
+	while (l->finished < n) {
+		if (l->next < n && l->nfree > 0) {
+			size_t idx = l->free[--l->nfree];
+			pthread_mutex_unlock(&l->lock);
+			int rc = start(l, idx);
+			pthread_mutex_lock(&l->lock);
+			if (rc < 0) { goto error; }
+			continue;
+		}
+
+#ifdef HAVE_URING
+		if (l->inflight > 0) {
+			pthread_mutex_unlock(&l->lock);
+			int rc = uring_reap(l);
+			pthread_mutex_lock(&l->lock);
+			if (rc < 0) { goto error; }
+			continue;
+		}
+#endif
+
+		// everything left is being parsed, so wait for a slot to come back
+		pthread_cond_wait(&l->freed, &l->lock);
+	}
+	pthread_mutex_unlock(&l->lock);
+
+#ifdef HAVE_URING
+	// submit and drain any trailing closes
+	while (l->uring && l->inflight > 0) {
+		if (uring_reap(l) < 0) { return -1; }
+	}
+#endif
+	return 0;
+
+error:
+	pthread_mutex_unlock(&l->lock);
+	return -1;
+}
+
+int
+tini_batch_load(const struct tini_batch *batch)
+{
+	struct loader l = {
+		.batch = batch,
+		.nslots = batch->depth ? batch->depth : DEPTH_DEFAULT,
+	};
+	int rc = -1, err = 0;
+	bool leak = false;
+
+	if (batch->npaths == 0) { return 0; }
+	if (l.nslots > batch->npaths) { l.nslots = batch->npaths; }
+
+	l.slots = calloc(l.nslots, sizeof(*l.slots));
+	l.free = calloc(l.nslots, sizeof(*l.free));
+	l.queue = calloc(l.nslots, sizeof(*l.queue));
+	l.workers = calloc(batch->nworkers + 1, sizeof(*l.workers));
+	if (!l.slots || !l.free || !l.queue || !l.workers) {
+		err = ENOMEM;
+		goto done;
+	}
+
+	for (size_t i = 0; i < l.nslots; i++) {
+		l.slots[i].fd = -1;
+		l.free[l.nfree++] = l.nslots - i - 1;
+	}
+
+#ifdef HAVE_URING
+	// io_uring may be missing or blocked, so fall back to plain syscalls
+	l.ring.fd = -1;
+	if (!(batch->options & TINI_BATCH_SYNC)) {
+		l.uring = ring_init(&l.ring, l.nslots * 4) == 0;
+	}
+#endif
+
+	pthread_mutex_init(&l.lock, NULL);
+	pthread_cond_init(&l.work, NULL);
+	pthread_cond_init(&l.freed, NULL);
+
+	for (; l.nworkers < batch->nworkers; l.nworkers++) {
+		if ((err = pthread_create(&l.workers[l.nworkers], NULL, worker, &l))) {
+			break;
+		}
+	}
+
+	if (err == 0) {
+		rc = run(&l);
+		if (rc < 0) { err = errno ? errno : EIO; }
+	}
+
+#ifdef HAVE_URING
+	// buffers the kernel may still write into are leaked rather than freed
+	if (rc < 0 && l.uring && uring_cancel(&l) < 0) {
+		leak = true;
+	}
+#endif
+
+	pthread_mutex_lock(&l.lock);
+	l.stop = true;
+	pthread_cond_broadcast(&l.work);
+	pthread_mutex_unlock(&l.lock);
+	for (unsigned i = 0; i < l.nworkers; i++) {
+		pthread_join(l.workers[i], NULL);
+	}
+
+	pthread_cond_destroy(&l.freed);
+	pthread_cond_destroy(&l.work);
+	pthread_mutex_destroy(&l.lock);
+
+#ifdef HAVE_URING
+	ring_free(&l.ring);
+#endif
+
+done:
+	// every path is reported, including those the batch gave up on
+	for (size_t i = 0; rc < 0 && l.slots && i < l.nslots; i++) {
+		struct slot *s = &l.slots[i];
+		if (s->io) {
+			s->err = err;
+			slot_parse(&l, s);
+		}
+	}
+	for (; rc < 0 && l.next < batch->npaths; l.next++) {
+		struct slot s = { .index = l.next, .err = err };
+		slot_parse(&l, &s);
+	}
+
+	if (l.slots) {
+		for (size_t i = 0; i < l.nslots; i++) {
+			if (l.slots[i].fd >= 0) { close(l.slots[i].fd); }
+			if (!leak) { free(l.slots[i].buf); }
+		}
+	}
+	if (!leak) { free(l.slots); }
+	free(l.free);
+	free(l.queue);
+	free(l.workers);
+	if (err) {
+		errno = err;
+		rc = -1;
+	}
+	return rc;
+}
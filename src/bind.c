@@ -0,0 +1,778 @@
+#include "../include/tini.h"
+#include "phash.h"
+#include "bind.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const struct tini *
+tini_error_node(const struct tini *key, const struct tini *value, enum tini_result rc)
+{
+	switch (rc) {
+	case TINI_SUCCESS: return NULL;
+	case TINI_SYNTAX: return key;
+	case TINI_STRING_TOO_BIG: return value;
+	case TINI_BOOL_FORMAT: return value;
+	case TINI_INTEGER_FORMAT: return value;
+	case TINI_INTEGER_TOO_SMALL: return value;
+	case TINI_INTEGER_TOO_BIG: return value;
+	case TINI_INTEGER_NEGATIVE: return value;
+	case TINI_NUMBER_FORMAT: return value;
+	case TINI_INVALID_TYPE: return value;
+	case TINI_UNUSED_SECTION: return key;
+	case TINI_UNUSED_KEY: return key;
+	case TINI_MISSING_SECTION: return key;
+	case TINI_MISSING_KEY: return key;
+	case TINI_ENUM_UNKNOWN: return value;
+	case TINI_DURATION_FORMAT: return value;
+	case TINI_DURATION_TOO_BIG: return value;
+	case TINI_SIZE_FORMAT: return value;
+	case TINI_SIZE_TOO_BIG: return value;
+	case TINI_TIME_FORMAT: return value;
+	case TINI_TIME_RANGE: return value;
+	case TINI_DUPLICATE_KEY: return key;
+	case TINI_REQUIRED_KEY: return key;
+	case TINI_VALUE_TOO_SMALL: return value;
+	case TINI_VALUE_TOO_BIG: return value;
+	case TINI_LENGTH_TOO_SHORT: return value;
+	case TINI_LENGTH_TOO_LONG: return value;
+	case TINI_VALUE_PATTERN: return value;
+	case TINI_MISSING_PARENT: return key;
+	case TINI_INHERIT_CYCLE: return key;
+	case TINI_INVALID_UTF8: return key;
+	case TINI_CONTROL_CHAR: return key;
+	case TINI_OUTPUT_ERROR: return value;
+	case TINI_NO_MEMORY: return key;
+	}
+	return key;
+}
+
+/**
+ * Targets loaded so far, so a repeated section header merges into its target
+ * instead of starting over. Each target has a seen bitset that is handed to
+ * the section so `tini_assign` can flag duplicates, and its required keys are
+ * checked once the whole text has been bound against the required bitset of
+ * its field table, which is built once per table. Bitsets live in `words`,
+ * `index` holds 1-based positions in `list` and `required` maps field tables
+ * to their bitsets, both using open addressing.
+ */
+struct bound
+{
+	void *target;
+	const struct tini_field *fields;
+	size_t nfields;
+	size_t seen;
+	size_t required;
+	struct tini name;
+	struct tini_source src;
+	bool inherited;
+};
+
+struct required
+{
+	const struct tini_field *fields;
+	size_t words;
+};
+
+struct track
+{
+	struct bound *list;
+	size_t count;
+	size_t cap;
+	uint32_t *index;
+	size_t mask;
+	uint64_t *words;
+	size_t nwords;
+	size_t wordcap;
+	struct required *required;
+	size_t nrequired;
+	size_t reqmask;
+};
+
+#define TRACK_WORDS(n) (((n) + 63) / 64)
+
+// the required offset of a field table without required keys
+#define TRACK_NONE SIZE_MAX
+
+static size_t
+track_slot(const struct track *t, const void *target,
+		const struct tini_field *fields)
+{
+	size_t i = tini_hash((const char *)&target, sizeof(target), 0) & t->mask;
+	for (;; i = (i + 1) & t->mask) {
+		uint32_t n = t->index[i];
+		if (n == 0 || (t->list[n-1].target == target &&
+				t->list[n-1].fields == fields)) {
+			return i;
+		}
+	}
+}
+
+static bool
+track_reserve(struct track *t, size_t nw)
+{
+	if (t->nwords + nw > t->wordcap) {
+		size_t cap = t->wordcap ? t->wordcap * 2 : 64;
+		while (cap < t->nwords + nw) { cap *= 2; }
+		uint64_t *words = realloc(t->words, cap * sizeof(*words));
+		if (words == NULL) { return false; }
+		t->words = words;
+		t->wordcap = cap;
+	}
+	return true;
+}
+
+static struct required *
+required_slot(const struct track *t, const struct tini_field *fields)
+{
+	size_t i = tini_hash((const char *)&fields, sizeof(fields), 0) & t->reqmask;
+	for (;; i = (i + 1) & t->reqmask) {
+		struct required *r = &t->required[i];
+		if (r->fields == NULL || r->fields == fields) {
+			return r;
+		}
+	}
+}
+
+/**
+ * Finds the offset of the required bitset for a field table in `words`,
+ * building it the first time the table is loaded. Sets `*off` to TRACK_NONE
+ * when no field is required.
+ */
+static bool
+track_required(struct track *t, const struct tini_field *fields, size_t nfields,
+		size_t *off)
+{
+	if ((t->nrequired + 1) * 2 > t->reqmask + 1 || t->required == NULL) {
+		size_t n = t->required ? (t->reqmask + 1) * 2 : 16;
+		struct track grown = { .required = calloc(n, sizeof(*grown.required)),
+			.reqmask = n - 1 };
+		if (grown.required == NULL) { return false; }
+		for (size_t i = 0; t->required && i <= t->reqmask; i++) {
+			if (t->required[i].fields) {
+				*required_slot(&grown, t->required[i].fields) = t->required[i];
+			}
+		}
+		free(t->required);
+		t->required = grown.required;
+		t->reqmask = grown.reqmask;
+	}
+
+	struct required *r = required_slot(t, fields);
+	if (r->fields == NULL) {
+		size_t nw = TRACK_WORDS(nfields), words = TRACK_NONE;
+		for (size_t j = 0; j < nfields; j++) {
+			if (!(fields[j].flags & TINI_REQUIRED)) { continue; }
+			if (words == TRACK_NONE) {
+				if (!track_reserve(t, nw)) { return false; }
+				words = t->nwords;
+				memset(t->words + words, 0, nw * sizeof(*t->words));
+				t->nwords += nw;
+			}
+			t->words[words + (j >> 6)] |= UINT64_C(1) << (j & 63);
+		}
+		*r = (struct required){ fields, words };
+		t->nrequired++;
+	}
+	*off = r->words;
+	return true;
+}
+
+static bool
+track_grow(struct track *t, size_t nw)
+{
+	if (!track_reserve(t, nw)) { return false; }
+	if (t->count == t->cap) {
+		size_t cap = t->cap ? t->cap * 2 : 16;
+		struct bound *list = realloc(t->list, cap * sizeof(*list));
+		if (list == NULL) { return false; }
+		t->list = list;
+		t->cap = cap;
+	}
+	if ((t->count + 1) * 2 > t->mask + 1 || t->index == NULL) {
+		size_t n = t->index ? (t->mask + 1) * 2 : 32;
+		uint32_t *index = calloc(n, sizeof(*index));
+		if (index == NULL) { return false; }
+		free(t->index);
+		t->index = index;
+		t->mask = n - 1;
+		for (size_t i = 0; i < t->count; i++) {
+			const struct bound *e = &t->list[i];
+			t->index[track_slot(t, e->target, e->fields)] = i + 1;
+		}
+	}
+	return true;
+}
+
+/**
+ * Finds the record for the section's target, adding one the first time the
+ * target is loaded. Sets `*first` when the record is new. Returns NULL if
+ * the section has no target or there is no memory for its record.
+ */
+static struct bound *
+track_begin(struct track *t, struct tini_section *load,
+		const struct tini_ctx *ctx, const struct tini *name, bool *first)
+{
+	*first = true;
+	load->seen = NULL;
+	if (load->target == NULL) { return NULL; }
+
+	struct bound *e = NULL;
+	if (t->index != NULL) {
+		uint32_t n = t->index[track_slot(t, load->target, load->fields)];
+		if (n != 0) { e = &t->list[n-1]; }
+	}
+	if (e == NULL) {
+		size_t nw = TRACK_WORDS(load->nfields), required;
+		if (!track_required(t, load->fields, load->nfields, &required) ||
+				!track_grow(t, nw)) {
+			return NULL;
+		}
+		e = &t->list[t->count++];
+		*e = (struct bound){
+			.target = load->target,
+			.fields = load->fields,
+			.nfields = load->nfields,
+			.seen = t->nwords,
+			.required = required,
+			.name = *name,
+			.src = { ctx->txt, ctx->txtlen, ctx->txtline },
+		};
+		t->index[track_slot(t, e->target, e->fields)] = t->count;
+		memset(t->words + t->nwords, 0, nw * sizeof(*t->words));
+		t->nwords += nw;
+	}
+	else {
+		*first = false;
+	}
+	load->seen = t->words + e->seen;
+	return e;
+}
+
+/**
+ * Switches the text that errors are located in.
+ */
+static void
+bind_text(struct tini_ctx *ctx, const struct tini_source *src)
+{
+	if (ctx->txt != src->txt) {
+		ctx->txt = src->txt;
+		ctx->txtlen = src->txtlen;
+		ctx->txtline = src->line;
+		ctx->cursor = NULL;
+	}
+}
+
+/**
+ * Reports the missing required keys of every target against the header that
+ * first loaded it, located in the text that header came from.
+ */
+static void
+track_end(struct track *t, struct tini_ctx *ctx)
+{
+	struct tini_source src = { ctx->txt, ctx->txtlen, ctx->txtline };
+
+	for (size_t i = 0; i < t->count; i++) {
+		const struct bound *e = &t->list[i];
+		// an inherited target starts from a parent that had its own required keys
+		if (e->inherited || e->required == TRACK_NONE) { continue; }
+		const uint64_t *seen = t->words + e->seen;
+		const uint64_t *required = t->words + e->required;
+		for (size_t w = 0; w < TRACK_WORDS(e->nfields); w++) {
+			uint64_t missing = required[w] & ~seen[w];
+			for (; missing; missing &= missing - 1) {
+				size_t j = w * 64 + __builtin_ctzll(missing);
+				bind_text(ctx, &e->src);
+				tini_add_error_arg(ctx, &e->name, e->fields[j].name,
+						TINI_REQUIRED_KEY);
+			}
+		}
+	}
+	bind_text(ctx, &src);
+}
+
+static void
+track_free(struct track *t)
+{
+	free(t->list);
+	free(t->index);
+	free(t->words);
+	free(t->required);
+}
+
+/**
+ * Sections bound so far, indexed by name, for `TINI_INHERIT`, with the label
+ * each one inherited from so a chain of parents can be followed. The table
+ * uses open addressing and is kept at most half full.
+ */
+struct parent
+{
+	struct tini name;
+	struct tini label;
+	void *target;
+	size_t size;
+	const struct tini_field *fields;
+	struct tini_origin *origins;
+};
+
+struct parents
+{
+	struct parent *tab;
+	size_t count;
+	size_t mask;
+};
+
+static struct parent *
+parents_slot(const struct parents *ps, const struct tini *name)
+{
+	size_t i = tini_hash(name->start, name->length, 0) & ps->mask;
+	for (;; i = (i + 1) & ps->mask) {
+		struct parent *p = &ps->tab[i];
+		if (p->target == NULL || (p->name.length == name->length &&
+				memcmp(p->name.start, name->start, name->length) == 0)) {
+			return p;
+		}
+	}
+}
+
+static const struct parent *
+parents_find(const struct parents *ps, const struct tini *name)
+{
+	if (ps->tab == NULL) { return NULL; }
+	const struct parent *p = parents_slot(ps, name);
+	return p->target ? p : NULL;
+}
+
+static int
+parents_add(struct parents *ps, const struct tini *name,
+		const struct tini *label, const struct tini_section *s)
+{
+	if ((ps->count + 1) * 2 > ps->mask + 1 || ps->tab == NULL) {
+		size_t n = ps->tab ? (ps->mask + 1) * 2 : 16;
+		struct parents grown = { calloc(n, sizeof(*grown.tab)), 0, n - 1 };
+		if (grown.tab == NULL) { return -1; }
+		for (size_t i = 0; ps->tab && i <= ps->mask; i++) {
+			if (ps->tab[i].target) {
+				*parents_slot(&grown, &ps->tab[i].name) = ps->tab[i];
+				grown.count++;
+			}
+		}
+		free(ps->tab);
+		*ps = grown;
+	}
+
+	// a repeated section name replaces the earlier parent, but a repeated
+	// header of the same target keeps the label it first inherited from
+	struct parent *p = parents_slot(ps, name);
+	struct tini from = label ? *label : (struct tini){ .type = TINI_NONE };
+	if (p->target == s->target) {
+		from = p->label;
+	}
+	ps->count += p->target == NULL;
+	*p = (struct parent){ *name, from, s->target, s->size, s->fields, s->origins };
+	return 0;
+}
+
+/**
+ * Binding state for `tini_parse`. Sections are loaded through the context's
+ * `load_section` callback and keys are assigned through the section, either
+ * one at a time or collected into `pairs` for `assign_batch`.
+ */
+struct bind
+{
+	struct tini_ctx *ctx;
+	int flags;
+	struct tini_section load;
+	struct tini global;
+	struct tini loaded;
+	struct track track;
+	struct tini_pair *pairs;
+	size_t npairs;
+	size_t cap;
+	struct parents parents;
+	bool inherited;
+	bool global_section;
+	bool has_section;
+};
+
+static void
+bind_init(struct bind *b, struct tini_ctx *ctx, const char *txt, int flags)
+{
+	*b = (struct bind){
+		.ctx = ctx,
+		.flags = flags,
+		.global = { .start = txt, .type = TINI_SECTION, .line_start = txt },
+		.global_section = true,
+	};
+	b->loaded = b->global;
+}
+
+static void
+bind_report(struct bind *b, enum tini_result rc,
+		const struct tini *key, const struct tini *value)
+{
+	if (rc == TINI_DUPLICATE_KEY && !(b->flags & TINI_DENY_DUPLICATES)) {
+		rc = TINI_SUCCESS;
+	}
+	if (rc != TINI_SUCCESS) {
+		tini_add_error(b->ctx, tini_error_node(key, value, rc), NULL, rc);
+	}
+}
+
+static void
+bind_flush(struct bind *b)
+{
+	size_t n = b->npairs;
+	if (n == 0) { return; }
+	b->npairs = 0;
+
+	if (b->load.assign_batch(&b->load, b->pairs, n, b->ctx->udata) == 0) {
+		return;
+	}
+	for (size_t i = 0; i < n; i++) {
+		bind_report(b, b->pairs[i].rc, &b->pairs[i].key, &b->pairs[i].value);
+	}
+}
+
+/**
+ * Checks if following the labels up from `label` leads back to `name`, such
+ * as `[b : a]` after `[a : b]`. The walk is bounded by the number of parents
+ * in case a repeated name rewired an earlier chain.
+ */
+static bool
+bind_cycle(const struct bind *b, const struct tini *name, const struct tini *label)
+{
+	const struct tini *up = label;
+	for (size_t n = 0; n <= b->parents.count; n++) {
+		if (tini_eq(name, up->start, up->length)) {
+			return true;
+		}
+		const struct parent *p = parents_find(&b->parents, up);
+		if (p == NULL || p->label.start == NULL) {
+			return false;
+		}
+		up = &p->label;
+	}
+	return false;
+}
+
+/**
+ * Starts a section as a copy of the fully bound section named by its label.
+ * Parents must appear earlier in the text and bind the same field table, and
+ * may not inherit from the section itself, directly or further up.
+ */
+static void
+bind_inherit(struct bind *b, const struct tini *name, const struct tini *label)
+{
+	if (bind_cycle(b, name, label)) {
+		tini_add_error(b->ctx, label, NULL, TINI_INHERIT_CYCLE);
+		return;
+	}
+
+	const struct parent *p = parents_find(&b->parents, label);
+	if (p == NULL) {
+		tini_add_error(b->ctx, label, NULL, TINI_MISSING_PARENT);
+		return;
+	}
+	if (p->fields != b->load.fields || p->size != b->load.size ||
+			b->load.target == NULL) {
+		tini_add_error(b->ctx, label, NULL, TINI_INVALID_TYPE);
+		return;
+	}
+
+	if (p->target != b->load.target) {
+		memcpy(b->load.target, p->target, p->size);
+	}
+	// inherited fields keep the origins of the parent's values
+	if (p->origins && b->load.origins && p->origins != b->load.origins) {
+		memcpy(b->load.origins, p->origins, b->load.nfields * sizeof(*p->origins));
+	}
+	b->inherited = true;
+}
+
+/**
+ * Finishes the current section by delivering any batched pairs.
+ */
+static void
+bind_close(struct bind *b)
+{
+	bind_flush(b);
+	b->has_section = false;
+}
+
+static enum tini_result
+bind_load(struct bind *b, const struct tini *name, const struct tini *label)
+{
+	struct tini_ctx *ctx = b->ctx;
+
+	bind_close(b);
+
+	b->load = (struct tini_section){ .assign = tini_assign };
+	enum tini_result rc = ctx->load_section ?
+		ctx->load_section(&b->load, name, label, ctx->udata) :
+		TINI_UNUSED_SECTION;
+	b->has_section = rc == TINI_SUCCESS;
+	if (!b->has_section) {
+		return rc;
+	}
+	// a custom assign sees every pair, so batching only replaces the default
+	if ((b->flags & TINI_BATCH) && b->load.assign == tini_assign &&
+			b->load.assign_batch == NULL) {
+		b->load.assign_batch = tini_assign_batch;
+	}
+
+	bool first;
+	struct bound *e = track_begin(&b->track, &b->load, ctx, name, &first);
+
+	b->loaded = *name;
+	b->inherited = false;
+	// like defaults, a parent is only copied when the target is first loaded
+	if ((b->flags & TINI_INHERIT) && label && first) {
+		bind_inherit(b, name, label);
+	}
+	if (e && b->inherited) {
+		e->inherited = true;
+	}
+	// a repeated header merges into what the first one bound
+	if (first && !b->inherited && b->load.defaults && b->load.target) {
+		memcpy(b->load.target, b->load.defaults, b->load.size);
+		if (b->load.origins) {
+			memset(b->load.origins, 0, b->load.nfields * sizeof(*b->load.origins));
+		}
+	}
+	if ((b->flags & TINI_INHERIT) && b->load.target && b->load.size) {
+		// without memory for the index, later children report a missing parent
+		(void)parents_add(&b->parents, name, label, &b->load);
+	}
+	return TINI_SUCCESS;
+}
+
+static void
+bind_section(struct bind *b, const struct tini *name, const struct tini *label)
+{
+	enum tini_result rc = bind_load(b, name, label);
+	if (rc != TINI_SUCCESS) {
+		tini_add_error(b->ctx, name, NULL, rc);
+	}
+}
+
+static void
+bind_value(struct bind *b, const struct tini *key, const struct tini *value)
+{
+	struct tini_ctx *ctx = b->ctx;
+
+	// the global section is only loaded once it has a key
+	if (b->global_section && !b->has_section) {
+		bind_section(b, &b->global, NULL);
+	}
+
+	if (b->has_section && b->load.origins) {
+		struct tini located = *value;
+		tini_ctx_locate(ctx, &located);
+		b->load.origin = (struct tini_origin){
+			.line = located.line + 1,
+			.file = ctx->file,
+			.layer = ctx->layer,
+		};
+	}
+	else if (b->has_section && b->load.assign_batch) {
+		size_t max = b->load.batch ? b->load.batch : SIZE_MAX;
+		if (b->npairs == b->cap && b->cap < max) {
+			size_t cap = b->cap ? b->cap * 2 : 64;
+			if (cap > max) { cap = max; }
+			struct tini_pair *pairs = realloc(b->pairs, cap * sizeof(*pairs));
+			if (pairs != NULL) {
+				b->pairs = pairs;
+				b->cap = cap;
+			}
+		}
+		// a full buffer that cannot grow is delivered early
+		if (b->npairs == b->cap || b->npairs == max) {
+			bind_flush(b);
+		}
+		if (b->npairs < b->cap) {
+			b->pairs[b->npairs++] = (struct tini_pair){ *key, *value, TINI_SUCCESS };
+			return;
+		}
+	}
+
+	enum tini_result rc = b->load.assign ?
+		b->load.assign(&b->load, key, value, ctx->udata) :
+		TINI_UNUSED_SECTION;
+	bind_report(b, rc, key, value);
+}
+
+static void
+bind_final(struct bind *b, bool complete)
+{
+	if (complete) {
+		bind_close(b);
+		track_end(&b->track, b->ctx);
+	}
+	else {
+		bind_flush(b);
+	}
+	track_free(&b->track);
+	free(b->pairs);
+	free(b->parents.tab);
+}
+
+/**
+ * Reports every invalid byte in [p, pe). Text is validated a line at a time
+ * as the iterator passes it, while it is still in cache.
+ */
+static void
+bind_validate(struct bind *b, const char *p, const char *pe)
+{
+	enum tini_result rc;
+	while ((p = tini_validate(p, pe, &rc)) != NULL) {
+		struct tini node = { .start = p, .length = 1, .type = TINI_NONE };
+		tini_add_error(b->ctx, &node, NULL, rc);
+		// report a broken sequence once rather than once per byte
+		for (p++; rc == TINI_INVALID_UTF8 && p < pe && (*p & 0xc0) == 0x80; p++) {}
+	}
+}
+
+/**
+ * Checks if the line holding `p` is a section header.
+ */
+static bool
+header_line(const char *txt, const char *pe, const char *p)
+{
+	while (p > txt && p[-1] != '\n') { p--; }
+	while (p < pe && (*p == ' ' || *p == '\t')) { p++; }
+	return p < pe && *p == '[';
+}
+
+enum tini_result
+tini_parse(struct tini_ctx *ctx,
+		const char *txt, size_t txtlen,
+		int flags)
+{
+	struct tini_iter it;
+	struct tini_event ev;
+	struct bind b;
+	bool complete = true;
+	bool validate = flags & TINI_VALIDATE;
+	const char *checked = txt;
+
+	ctx->txt = txt;
+	ctx->txtlen = txtlen;
+	ctx->txtline = 0;
+	ctx->nerr = 0;
+	ctx->cursor = NULL;
+
+	bind_init(&b, ctx, txt, flags);
+	tini_iter_init(&it, txt, txtlen);
+	it.flags = flags;
+
+	while (tini_next(&it, &ev)) {
+		if (validate) {
+			const char *end = ev.type == TINI_EVENT_ERROR ? ev.name.start : it.p;
+			bind_validate(&b, checked, end);
+			checked = end;
+		}
+
+		switch (ev.type) {
+		case TINI_EVENT_SECTION:
+			b.global_section = false;
+			bind_section(&b, &ev.name,
+					ev.value.type == TINI_LABEL ? &ev.value : NULL);
+			break;
+		case TINI_EVENT_VALUE:
+			bind_value(&b, &ev.name, &ev.value);
+			break;
+		case TINI_EVENT_ERROR:
+			bind_flush(&b);
+			tini_add_error(ctx, &ev.name, NULL, ev.code);
+			if (flags & TINI_RECOVER) {
+				// keys after a broken header belong to a section that was never
+				// loaded, so they are reported as unused until the next header
+				if (header_line(txt, txt + txtlen, ev.name.start)) {
+					b.global_section = false;
+					bind_close(&b);
+					b.load = (struct tini_section){ 0 };
+				}
+				// the broken line is not validated
+				tini_iter_recover(&it);
+				checked = it.p;
+			}
+			else {
+				complete = false;
+			}
+			break;
+		case TINI_EVENT_NONE:
+			break;
+		}
+	}
+
+	if (validate && complete) {
+		bind_validate(&b, checked, txt + txtlen);
+	}
+	bind_final(&b, complete);
+
+	return ctx->nerr ? ctx->err[0].code : TINI_SUCCESS;
+}
+
+enum tini_result
+tini_bind_events(struct tini_ctx *ctx, int flags,
+		bool (*next)(struct tini_event *ev, struct tini_source *src, void *udata),
+		void *udata)
+{
+	struct tini_event ev;
+	struct bind b;
+	struct tini_source src = { 0 }, section = { 0 };
+	bool complete = true;
+
+	ctx->txt = NULL;
+	ctx->txtlen = 0;
+	ctx->txtline = 0;
+	ctx->nerr = 0;
+	ctx->cursor = NULL;
+
+	bind_init(&b, ctx, NULL, flags);
+	b.global_section = false;
+
+	while (next(&ev, &src, udata)) {
+		if (ev.type == TINI_EVENT_SECTION) {
+			// the previous section reports against the text of its own header
+			bind_text(ctx, &section);
+			bind_close(&b);
+			section = src;
+		}
+		bind_text(ctx, &src);
+
+		switch (ev.type) {
+		case TINI_EVENT_SECTION:
+			bind_section(&b, &ev.name,
+					ev.value.type == TINI_LABEL ? &ev.value : NULL);
+			break;
+		case TINI_EVENT_VALUE:
+			bind_value(&b, &ev.name, &ev.value);
+			break;
+		case TINI_EVENT_ERROR:
+			if (ev.code != TINI_SYNTAX) {
+				// invalid text is reported without stopping
+				tini_add_error(ctx, &ev.name, NULL, ev.code);
+				break;
+			}
+			bind_flush(&b);
+			tini_add_error(ctx, &ev.name, NULL, ev.code);
+			if (!(flags & TINI_RECOVER)) {
+				complete = false;
+			}
+			else if (header_line(src.txt, src.txt + src.txtlen, ev.name.start)) {
+				bind_close(&b);
+				b.load = (struct tini_section){ 0 };
+			}
+			break;
+		case TINI_EVENT_NONE:
+			break;
+		}
+	}
+
+	bind_text(ctx, &section);
+	bind_final(&b, complete);
+
+	return ctx->nerr ? ctx->err[0].code : TINI_SUCCESS;
+}
@@ -0,0 +1,31 @@
+#ifndef TINI_BIND_H
+#define TINI_BIND_H
+
+#include "../include/tini.h"
+
+/**
+ * A text that events point into, and the line it starts on when it is one
+ * window of a longer input.
+ */
+struct tini_source
+{
+	const char *txt;
+	size_t txtlen;
+	uint32_t line;
+};
+
+/**
+ * Binds a stream of events through the context's `load_section` callback,
+ * like `tini_parse`. Each event may come from a different text, which `next`
+ * returns alongside it so errors are located in the right buffer. Keys are
+ * only bound inside explicit sections; global keys follow a section event
+ * with an empty name. Error events are reported; a syntax error ends the
+ * binding unless `TINI_RECOVER` is set, and `next` is expected to return
+ * false after it.
+ */
+extern enum tini_result
+tini_bind_events(struct tini_ctx *ctx, int flags,
+		bool (*next)(struct tini_event *ev, struct tini_source *src, void *udata),
+		void *udata);
+
+#endif
@@ -0,0 +1,156 @@
+#include "../include/tini.h"
+#include "phash.h"
+
+#include <stdlib.h>
+
+#define BLOCK_BASE 16
+
+/**
+ * Block `k` holds `BLOCK_BASE << k` elements, so element `i` lives in block
+ * `log2(i / BLOCK_BASE + 1)`. Elements never move once allocated, which keeps
+ * section targets valid for inheritance while later blocks are added.
+ */
+static inline size_t
+block_of(size_t i, size_t *off)
+{
+	size_t k = 63 - __builtin_clzll(i / BLOCK_BASE + 1);
+	*off = i - BLOCK_BASE * ((UINT64_C(1) << k) - 1);
+	return k;
+}
+
+void *
+tini_collection_at(const struct tini_collection *c, size_t i)
+{
+	size_t off;
+	size_t k = block_of(i, &off);
+	return c->blocks[k] + off * c->size;
+}
+
+const char *
+tini_collection_label(const struct tini_collection *c, size_t i)
+{
+	return c->names + c->labels[i].offset;
+}
+
+static size_t
+index_slot(const struct tini_collection *c, const char *label, size_t len)
+{
+	size_t i = tini_hash(label, len, 0) & c->mask;
+	for (; c->index[i]; i = (i + 1) & c->mask) {
+		const struct tini_span *s = &c->labels[c->index[i] - 1];
+		if (s->length == len && memcmp(c->names + s->offset, label, len) == 0) {
+			break;
+		}
+	}
+	return i;
+}
+
+void *
+tini_collection_find(const struct tini_collection *c, const char *label, size_t len)
+{
+	if (c->index == NULL) { return NULL; }
+	uint32_t id = c->index[index_slot(c, label, len)];
+	return id ? tini_collection_at(c, id - 1) : NULL;
+}
+
+static int
+index_grow(struct tini_collection *c)
+{
+	if (c->index && (c->count + 1) * 2 <= c->mask + 1) {
+		return 0;
+	}
+
+	size_t n = c->index ? (c->mask + 1) * 2 : 64;
+	struct tini_collection grown = *c;
+	grown.index = calloc(n, sizeof(*grown.index));
+	grown.mask = n - 1;
+	if (grown.index == NULL) { return -1; }
+
+	for (size_t i = 0; i < c->count; i++) {
+		const struct tini_span *s = &c->labels[i];
+		grown.index[index_slot(&grown, c->names + s->offset, s->length)] = i + 1;
+	}
+	free(c->index);
+	c->index = grown.index;
+	c->mask = grown.mask;
+	return 0;
+}
+
+static void *
+add(struct tini_collection *c, const char *label, size_t len)
+{
+	size_t off;
+	size_t k = block_of(c->count, &off);
+	if (k >= TINI_COLLECTION_BLOCKS) { return NULL; }
+	if (c->blocks[k] == NULL) {
+		c->blocks[k] = malloc((BLOCK_BASE << k) * c->size);
+		if (c->blocks[k] == NULL) { return NULL; }
+	}
+
+	if (c->count == c->labelcap) {
+		size_t cap = c->labelcap ? c->labelcap * 2 : 64;
+		struct tini_span *labels = realloc(c->labels, cap * sizeof(*labels));
+		if (labels == NULL) { return NULL; }
+		c->labels = labels;
+		c->labelcap = cap;
+	}
+	// labels are kept NUL-terminated for `tini_collection_label`
+	if (c->nameslen + len + 1 > c->namescap) {
+		size_t cap = c->namescap ? c->namescap * 2 : 1024;
+		while (cap < c->nameslen + len + 1) { cap *= 2; }
+		char *names = realloc(c->names, cap);
+		if (names == NULL) { return NULL; }
+		c->names = names;
+		c->namescap = cap;
+	}
+	if (index_grow(c) < 0) { return NULL; }
+
+	if (len > 0) { memcpy(c->names + c->nameslen, label, len); }
+	c->names[c->nameslen + len] = '\0';
+	c->labels[c->count] = (struct tini_span){ c->nameslen, len };
+	c->nameslen += len + 1;
+	size_t slot = index_slot(c, label, len);
+	c->index[slot] = ++c->count;
+
+	void *elem = c->blocks[k] + off * c->size;
+	if (c->defaults) { memcpy(elem, c->defaults, c->size); }
+	else { memset(elem, 0, c->size); }
+	return elem;
+}
+
+enum tini_result
+tini_collection_load(struct tini_collection *c, struct tini_section *section,
+		const struct tini *label)
+{
+	const char *l = label ? label->start : "";
+	size_t len = label ? label->length : 0;
+
+	void *elem = tini_collection_find(c, l, len);
+	if (elem == NULL && (elem = add(c, l, len)) == NULL) {
+		return TINI_NO_MEMORY;
+	}
+
+	// defaults were applied when the element was added, so a repeated label
+	// merges into the element instead of starting over
+	section->fields = c->fields;
+	section->nfields = c->nfields;
+	section->target = elem;
+	section->size = c->size;
+	return TINI_SUCCESS;
+}
+
+void
+tini_collection_free(struct tini_collection *c)
+{
+	for (size_t k = 0; k < TINI_COLLECTION_BLOCKS; k++) {
+		free(c->blocks[k]);
+		c->blocks[k] = NULL;
+	}
+	free(c->labels);
+	free(c->names);
+	free(c->index);
+	c->labels = NULL;
+	c->names = NULL;
+	c->index = NULL;
+	c->count = c->labelcap = c->nameslen = c->namescap = c->mask = 0;
+}
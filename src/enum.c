@@ -0,0 +1,86 @@
+#include "../include/tini.h"
+#include "phash.h"
+
+int
+tini_enum_compile(struct tini_enum *e)
+{
+	return tini_phash_build(&e->hash, e->values,
+			sizeof(*e->values), e->nvalues);
+}
+
+void
+tini_enum_free(struct tini_enum *e)
+{
+	tini_phash_free(&e->hash);
+}
+
+const struct tini_enum_value *
+tini_enum_find(const struct tini_enum *e, const char *name, size_t len)
+{
+	if (e->hash.nbuckets) {
+		ssize_t idx = tini_phash_find(&e->hash, e->values,
+				sizeof(*e->values), name, len);
+		return idx < 0 ? NULL : &e->values[idx];
+	}
+
+	// tables that were never compiled fall back to a linear scan
+	const struct tini_enum_value *p = e->values, *pe = p + e->nvalues;
+	for (; p < pe; p++) {
+		if (strncmp(p->name, name, len) == 0 && p->name[len] == '\0') {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+enum tini_result
+tini_enum_parse(int64_t *t, const struct tini_enum *e,
+		const struct tini *value)
+{
+	const struct tini_enum_value *v =
+		tini_enum_find(e, value->start, value->length);
+	if (v == NULL) {
+		return TINI_ENUM_UNKNOWN;
+	}
+	*t = v->value;
+	return TINI_SUCCESS;
+}
+
+static bool
+is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+}
+
+enum tini_result
+tini_flags_parse(int64_t *t, const struct tini_enum *e,
+		const struct tini *value)
+{
+	const char *p = value->start, *pe = p + value->length;
+	int64_t bits = 0;
+
+	while (p < pe && is_space(*p)) { p++; }
+	while (pe > p && is_space(pe[-1])) { pe--; }
+
+	// an empty value is an empty mask, but "a||b" is not
+	while (p < pe) {
+		const char *sep = memchr(p, '|', pe - p);
+		const char *end = sep ? sep : pe;
+		while (end > p && is_space(end[-1])) { end--; }
+
+		const struct tini_enum_value *v = tini_enum_find(e, p, end - p);
+		if (v == NULL) {
+			return TINI_ENUM_UNKNOWN;
+		}
+		bits |= v->value;
+
+		if (sep == NULL) { break; }
+		for (p = sep + 1; p < pe && is_space(*p); p++) {}
+		if (p == pe) {
+			return TINI_ENUM_UNKNOWN;
+		}
+	}
+
+	*t = bits;
+	return TINI_SUCCESS;
+}
@@ -4,10 +4,9 @@
 #include <unistd.h>
 #include <stdarg.h>
 
-#define LOC "\x1b[1m"
-#define ERR "\x1b[1;31m"
-#define RNG "\x1b[1;32m"
-#define RST "\x1b[0m"
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 
 #define ERR_MAX (sizeof(((struct tini_ctx *)0)->err)/sizeof(((struct tini_ctx *)0)->err[0]))
 
@@ -29,10 +28,95 @@ tini_msg(enum tini_result rc)
 	case TINI_UNUSED_KEY:        return "unsupported key";
 	case TINI_MISSING_SECTION:   return "section not allowed";
 	case TINI_MISSING_KEY:       return "key not allowed";
+	case TINI_ENUM_UNKNOWN:      return "unknown enumeration value";
+	case TINI_DURATION_FORMAT:   return "invalid duration format";
+	case TINI_DURATION_TOO_BIG:  return "duration too large";
+	case TINI_SIZE_FORMAT:       return "invalid size format";
+	case TINI_SIZE_TOO_BIG:      return "size too large";
+	case TINI_TIME_FORMAT:       return "invalid timestamp format";
+	case TINI_TIME_RANGE:        return "timestamp out of range";
+	case TINI_DUPLICATE_KEY:     return "duplicate key";
+	case TINI_REQUIRED_KEY:      return "required key not set";
+	case TINI_VALUE_TOO_SMALL:   return "value below minimum";
+	case TINI_VALUE_TOO_BIG:     return "value above maximum";
+	case TINI_LENGTH_TOO_SHORT:  return "value too short";
+	case TINI_LENGTH_TOO_LONG:   return "value too long";
+	case TINI_VALUE_PATTERN:     return "value does not match pattern";
+	case TINI_MISSING_PARENT:    return "parent section not found";
+	case TINI_INHERIT_CYCLE:     return "section inherits from itself";
+	case TINI_INVALID_UTF8:      return "invalid UTF-8";
+	case TINI_CONTROL_CHAR:      return "control character not allowed";
+	case TINI_OUTPUT_ERROR:      return "output could not be written";
+	case TINI_NO_MEMORY:         return "out of memory";
 	}
 	return "unknown error";
 }
 
+/**
+ * Counts the newlines in [p, pe) a vector (or word) at a time.
+ */
+static uint32_t
+count_lines(const char *p, const char *pe)
+{
+	uint32_t n = 0;
+
+#ifdef __SSE2__
+	const __m128i nl = _mm_set1_epi8('\n');
+	for (; pe - p >= 16; p += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+		n += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+	}
+#else
+	const uint64_t lo7 = 0x7f7f7f7f7f7f7f7fULL;
+	for (; pe - p >= 8; p += 8) {
+		uint64_t w;
+		memcpy(&w, p, sizeof(w));
+		w ^= 0x0a0a0a0a0a0a0a0aULL;
+		// the high bit of each byte is clear only where the byte was '\n'
+		uint64_t t = ((w & lo7) + lo7) | w;
+		n += __builtin_popcountll(~t & ~lo7);
+	}
+#endif
+
+	for (; p < pe; p++) {
+		n += *p == '\n';
+	}
+	return n;
+}
+
+static void
+locate(const char *txt, const char *from, uint32_t line, struct tini *node)
+{
+	const char *bol = node->start;
+	while (bol > txt && bol[-1] != '\n') { bol--; }
+
+	node->line_start = bol;
+	node->line = line + count_lines(from, node->start);
+	node->column = node->start - bol;
+}
+
+void
+tini_locate(const char *txt, struct tini *node)
+{
+	locate(txt, txt, 0, node);
+}
+
+void
+tini_ctx_locate(struct tini_ctx *ctx, struct tini *node)
+{
+	const char *txt = ctx->txt;
+	if (txt == NULL || node->start < txt || node->start > txt + ctx->txtlen) {
+		return;
+	}
+	if (ctx->cursor == NULL || ctx->cursor > node->start) {
+		ctx->cursor = txt;
+		ctx->cursor_line = ctx->txtline;
+	}
+	locate(txt, ctx->cursor, ctx->cursor_line, node);
+	ctx->cursor = node->start;
+	ctx->cursor_line = node->line;
+}
+
 void
 tini_add_error(struct tini_ctx *ctx, const struct tini *node,
 		const char *msg,
@@ -44,74 +128,122 @@ tini_add_error(struct tini_ctx *ctx, const struct tini *node,
 			.msg = msg,
 			.code = code,
 		};
+
+		struct tini *n = &ctx->err[ctx->nerr].node;
+		if (n->line_start == NULL) {
+			tini_ctx_locate(ctx, n);
+		}
 	}
 	ctx->nerr++;
 }
 
-static const char *
-msg(const struct tini_error *err)
+void
+tini_add_error_arg(struct tini_ctx *ctx, const struct tini *node,
+		const char *arg,
+		enum tini_result code)
 {
-	return err->msg ? err->msg : tini_msg(err->code);
+	tini_add_error(ctx, node, NULL, code);
+	if (ctx->nerr <= ERR_MAX) {
+		ctx->err[ctx->nerr - 1].arg = arg;
+	}
 }
 
-void
-tini_print_errors(const struct tini_ctx *ctx, const char *path, FILE *out)
+/**
+ * Writes rendered diagnostics to `out` with a single write, rendering again
+ * into a heap buffer if they do not fit on the stack.
+ */
+static void
+print_rendered(FILE *out, void (*render)(struct tini_render *, void *), void *arg)
 {
-	unsigned nerr = ctx->nerr;
-	if (nerr == 0) { return; }
-	if (nerr > ERR_MAX) { nerr = ERR_MAX; }
-
-	for (unsigned i = 0; i < nerr; i++) {
-		tini_errorf(ctx, &ctx->err[i].node, path, out, "%s", msg(&ctx->err[i]));
+	enum tini_format fmt = isatty(fileno(out)) ? TINI_FORMAT_COLOR : TINI_FORMAT_TEXT;
+	char stack[4096], *buf = stack;
+	struct tini_render r;
+
+	tini_render_begin(&r, fmt, buf, sizeof(stack));
+	render(&r, arg);
+	size_t n = tini_render_end(&r);
+	if (n > sizeof(stack) && (buf = malloc(n)) != NULL) {
+		tini_render_begin(&r, fmt, buf, n);
+		render(&r, arg);
+		tini_render_end(&r);
+	}
+	if (buf == NULL) {
+		buf = stack;
+		n = sizeof(stack);
 	}
+	fwrite(buf, 1, n, out);
+	if (buf != stack) { free(buf); }
+}
+
+struct print_errors
+{
+	const struct tini_ctx *ctx;
+	const char *path;
+};
 
-	if (nerr < ctx->nerr) {
-		fprintf(out, "showing %u of %u errors\n", nerr, ctx->nerr);
+static void
+render_errors(struct tini_render *r, void *arg)
+{
+	const struct print_errors *pe = arg;
+	unsigned nerr = pe->ctx->nerr, shown = nerr > ERR_MAX ? ERR_MAX : nerr;
+	char summary[64];
+	int n;
+
+	tini_render_errors(r, pe->ctx, pe->path);
+	if (shown < nerr) {
+		n = snprintf(summary, sizeof(summary), "showing %u of %u errors\n", shown, nerr);
 	}
-	else if (nerr == 1) {
-		fprintf(out, "showing 1 error\n");
+	else if (shown == 1) {
+		n = snprintf(summary, sizeof(summary), "showing 1 error\n");
 	}
 	else {
-		fprintf(out, "showing %u errors\n", nerr);
+		n = snprintf(summary, sizeof(summary), "showing %u errors\n", shown);
 	}
+	tini_render_put(r, summary, n);
+}
+
+void
+tini_print_errors(const struct tini_ctx *ctx, const char *path, FILE *out)
+{
+	if (ctx->nerr == 0) { return; }
+
+	struct print_errors pe = { ctx, path };
+	print_rendered(out, render_errors, &pe);
+}
+
+struct print_node
+{
+	const struct tini_ctx *ctx;
+	const struct tini *node;
+	const char *path;
+	const char *msg;
+};
+
+static void
+render_node(struct tini_render *r, void *arg)
+{
+	const struct print_node *pn = arg;
+	tini_render_node(r, pn->ctx, pn->node, pn->path, TINI_SUCCESS, pn->msg, NULL);
 }
 
 void
 tini_errorf(const struct tini_ctx *ctx, const struct tini *node,
 		const char *path, FILE *out, const char *fmt, ...)
 {
-	bool tty = isatty(fileno(out));
-	int ln = node->line;
-	int col = node->column;
-	const char *p = node->line_start;
-	const char *pe = p + col;
-	const char *eol = memchr(p, '\n', ctx->txtlen - (p - ctx->txt));
-	if (eol == NULL) { eol = ctx->txt + ctx->txtlen; }
-
-	if (tty) {
-		fprintf(out, LOC "%s:%d:%d: " RST ERR "error: " RST , path, ln+1, col+1);
-	}
-	else {
-		fprintf(out, "%s:%d:%d: error: ", path, ln+1, col+1);
-	}
-
+	char stack[256], *msg = stack;
 	va_list ap;
+
 	va_start(ap, fmt);
-	vfprintf(out, fmt, ap);
+	int n = vsnprintf(stack, sizeof(stack), fmt, ap);
 	va_end(ap);
-
-	fprintf(out, "\n    %.*s\n    ", (int)(eol - p), p);
-
-	for (; p < pe; p++) {
-		if (*p == '\t') { fwrite("        ", 1, 8, out); }
-		else { fputc(' ', out); }
+	if (n >= (int)sizeof(stack) && (msg = malloc(n + 1)) != NULL) {
+		va_start(ap, fmt);
+		vsnprintf(msg, n + 1, fmt, ap);
+		va_end(ap);
 	}
+	if (msg == NULL) { msg = stack; }
 
-	pe += node->length;
-	if (tty) { fwrite(RNG, 1, sizeof(RNG) - 1, out); }
-	fputc('^', out);
-	for (p++; p<pe; p++) { fputc('~', out); }
-	if (tty) { fwrite(RST, 1, sizeof(RST) - 1, out); }
-	fputc('\n', out);
+	struct print_node pn = { ctx, node, path, msg };
+	print_rendered(out, render_node, &pn);
+	if (msg != stack) { free(msg); }
 }
-
@@ -0,0 +1,154 @@
+#include "../include/tini.h"
+#include "phash.h"
+
+#include <stdlib.h>
+
+#define CHUNK_SIZE 16384
+
+struct tini_intern_chunk
+{
+	struct tini_intern_chunk *next;
+	char data[];
+};
+
+static size_t
+index_slot(const struct tini_intern *pool, const char *s, size_t len, uint32_t hash)
+{
+	size_t i = hash & pool->mask;
+	for (; pool->index[i]; i = (i + 1) & pool->mask) {
+		const struct tini_interned *e = &pool->strings[pool->index[i] - 1];
+		if (e->hash == hash && e->length == len && memcmp(e->str, s, len) == 0) {
+			break;
+		}
+	}
+	return i;
+}
+
+const char *
+tini_intern_find(const struct tini_intern *pool, const char *s, size_t len,
+		uint32_t *id)
+{
+	if (pool->index == NULL) { return NULL; }
+	uint32_t n = pool->index[index_slot(pool, s, len, (uint32_t)tini_hash(s, len, 0))];
+	if (n == 0) { return NULL; }
+	if (id) { *id = n - 1; }
+	return pool->strings[n - 1].str;
+}
+
+static int
+index_grow(struct tini_intern *pool)
+{
+	if (pool->index && (pool->count + 1) * 2 <= pool->mask + 1) {
+		return 0;
+	}
+
+	size_t n = pool->index ? (pool->mask + 1) * 2 : 256;
+	struct tini_intern grown = *pool;
+	grown.index = calloc(n, sizeof(*grown.index));
+	grown.mask = n - 1;
+	if (grown.index == NULL) { return -1; }
+
+	for (size_t i = 0; i < pool->count; i++) {
+		const struct tini_interned *e = &pool->strings[i];
+		grown.index[index_slot(&grown, e->str, e->length, e->hash)] = i + 1;
+	}
+	free(pool->index);
+	pool->index = grown.index;
+	pool->mask = grown.mask;
+	return 0;
+}
+
+/**
+ * Copies a string into the arena. Strings never move, and one longer than a
+ * chunk gets a chunk of its own.
+ */
+static int
+arena_reserve(struct tini_intern *pool, size_t len)
+{
+	size_t size = len + 1 > CHUNK_SIZE ? len + 1 : CHUNK_SIZE;
+	struct tini_intern_chunk *c = malloc(sizeof(*c) + size);
+	if (c == NULL) { return -1; }
+	c->next = pool->chunks;
+	pool->chunks = c;
+	pool->next = c->data;
+	pool->avail = size;
+	return 0;
+}
+
+static char *
+arena_copy(struct tini_intern *pool, const char *s, size_t len)
+{
+	if (len + 1 > pool->avail && arena_reserve(pool, len) < 0) {
+		return NULL;
+	}
+	char *str = pool->next;
+	// a string joined in place is already where it belongs
+	if (len > 0 && str != s) { memcpy(str, s, len); }
+	str[len] = '\0';
+	pool->next += len + 1;
+	pool->avail -= len + 1;
+	return str;
+}
+
+const char *
+tini_intern(struct tini_intern *pool, const char *s, size_t len, uint32_t *id)
+{
+	uint32_t hash = (uint32_t)tini_hash(s, len, 0);
+	if (pool->index) {
+		uint32_t n = pool->index[index_slot(pool, s, len, hash)];
+		if (n) {
+			if (id) { *id = n - 1; }
+			return pool->strings[n - 1].str;
+		}
+	}
+
+	if (len > UINT32_MAX || pool->count == UINT32_MAX - 1) { return NULL; }
+	if (pool->count == pool->cap) {
+		size_t cap = pool->cap ? pool->cap * 2 : 64;
+		struct tini_interned *strings = realloc(pool->strings, cap * sizeof(*strings));
+		if (strings == NULL) { return NULL; }
+		pool->strings = strings;
+		pool->cap = cap;
+	}
+	if (index_grow(pool) < 0) { return NULL; }
+
+	char *str = arena_copy(pool, s, len);
+	if (str == NULL) { return NULL; }
+
+	pool->strings[pool->count] = (struct tini_interned){ str, len, hash };
+	size_t slot = index_slot(pool, s, len, hash);
+	pool->index[slot] = ++pool->count;
+	if (id) { *id = pool->count - 1; }
+	return str;
+}
+
+const char *
+tini_intern_value(struct tini_intern *pool, const struct tini *value, uint32_t *id)
+{
+	if (value->type != TINI_CONTINUED) {
+		return tini_intern(pool, value->start, value->length, id);
+	}
+
+	// the segments are joined in the arena's free space, and only kept there
+	// if the joined string is new
+	size_t len = tini_length(value);
+	if (len + 1 > pool->avail && arena_reserve(pool, len) < 0) {
+		return NULL;
+	}
+	tini_str(pool->next, len + 1, value);
+	return tini_intern(pool, pool->next, len, id);
+}
+
+void
+tini_intern_free(struct tini_intern *pool)
+{
+	struct tini_intern_chunk *c = pool->chunks;
+	while (c) {
+		struct tini_intern_chunk *next = c->next;
+		free(c);
+		c = next;
+	}
+	free(pool->strings);
+	free(pool->index);
+	*pool = (struct tini_intern){ 0 };
+}
@@ -0,0 +1,373 @@
+#include "../include/tini.h"
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include <math.h>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+static void
+flush(struct tini_json *j)
+{
+	if (j->pos > 0 && !j->failed && j->write(j->buf, j->pos, j->udata) != 0) {
+		j->failed = true;
+	}
+	j->pos = 0;
+}
+
+static void
+put(struct tini_json *j, const char *s, size_t n)
+{
+	if (n == 0) {
+		return;
+	}
+	if (n > j->len - j->pos) {
+		flush(j);
+		// anything larger than the whole buffer bypasses it
+		if (n > j->len) {
+			if (!j->failed && j->write(s, n, j->udata) != 0) {
+				j->failed = true;
+			}
+			return;
+		}
+	}
+	memcpy(j->buf + j->pos, s, n);
+	j->pos += n;
+}
+
+#define PUTS(j, lit) put(j, lit, sizeof(lit) - 1)
+
+/**
+ * Finds the next byte in [p, pe) that must be escaped in a JSON string.
+ */
+static const char *
+find_escape(const char *p, const char *pe)
+{
+#ifdef __SSE2__
+	const __m128i quote = _mm_set1_epi8('"'), bslash = _mm_set1_epi8('\\');
+	const __m128i ctl = _mm_set1_epi8(0x1f);
+	for (; pe - p >= 16; p += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+		__m128i m = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+				_mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));
+		int mask = _mm_movemask_epi8(m);
+		if (mask != 0) {
+			return p + __builtin_ctz(mask);
+		}
+	}
+#endif
+	for (; p < pe; p++) {
+		uint8_t c = *p;
+		if (c < 0x20 || c == '"' || c == '\\') { break; }
+	}
+	return p;
+}
+
+static void
+put_escaped(struct tini_json *j, const char *p, size_t n)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char *pe = p + n;
+
+	while (p < pe) {
+		const char *esc = find_escape(p, pe);
+		put(j, p, esc - p);
+		if (esc == pe) { break; }
+
+		uint8_t c = *esc;
+		switch (c) {
+		case '"':  PUTS(j, "\\\""); break;
+		case '\\': PUTS(j, "\\\\"); break;
+		case '\t': PUTS(j, "\\t"); break;
+		case '\r': PUTS(j, "\\r"); break;
+		case '\n': PUTS(j, "\\n"); break;
+		default: {
+			char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+			put(j, u, sizeof(u));
+		}
+		}
+		p = esc + 1;
+	}
+}
+
+static void
+put_string(struct tini_json *j, const char *s, size_t n)
+{
+	PUTS(j, "\"");
+	put_escaped(j, s, n);
+	PUTS(j, "\"");
+}
+
+static void
+put_text(struct tini_json *j, const struct tini *value)
+{
+	const char *cursor = NULL;
+	struct tini seg;
+
+	PUTS(j, "\"");
+	while (tini_segment(value, &cursor, &seg)) {
+		put_escaped(j, seg.start, seg.length);
+	}
+	PUTS(j, "\"");
+}
+
+static void
+put_number(struct tini_json *j, double v)
+{
+	char tmp[32];
+	if (!isfinite(v)) {
+		PUTS(j, "null");
+		return;
+	}
+	// use the shortest of the two precisions that reads back exactly
+	int n = snprintf(tmp, sizeof(tmp), "%.15g", v);
+	if (strtod(tmp, NULL) != v) {
+		n = snprintf(tmp, sizeof(tmp), "%.17g", v);
+	}
+	put(j, tmp, n);
+}
+
+static void
+put_value(struct tini_json *j, struct tini_ctx *ctx,
+		const struct tini *key, const struct tini *value)
+{
+	const struct tini_field *f = j->section.fields ?
+		tini_field_find(&j->section, key->start, key->length) : NULL;
+	enum tini_result rc = TINI_SUCCESS;
+	char tmp[24];
+	int n = 0;
+
+	if (f == NULL) {
+		put_text(j, value);
+		return;
+	}
+
+	switch (f->type) {
+	case TINI_BOOL: {
+		bool v;
+		if ((rc = tini_bool(&v, value)) == TINI_SUCCESS) {
+			n = v ? 4 : 5;
+			memcpy(tmp, v ? "true" : "false", n);
+		}
+		break;
+	}
+	case TINI_SIGNED:
+	case TINI_DURATION:
+	case TINI_TIME: {
+		int64_t v;
+		if ((rc = tini_set(&v, sizeof(v), f->type, value)) == TINI_SUCCESS) {
+			n = snprintf(tmp, sizeof(tmp), "%" PRId64, v);
+		}
+		break;
+	}
+	case TINI_UNSIGNED:
+	case TINI_SIZE: {
+		uint64_t v;
+		if ((rc = tini_set(&v, sizeof(v), f->type, value)) == TINI_SUCCESS) {
+			n = snprintf(tmp, sizeof(tmp), "%" PRIu64, v);
+		}
+		break;
+	}
+	case TINI_NUMBER: {
+		double v;
+		if ((rc = tini_double(&v, value)) == TINI_SUCCESS) {
+			put_number(j, v);
+			return;
+		}
+		break;
+	}
+	default:
+		put_text(j, value);
+		return;
+	}
+
+	if (rc != TINI_SUCCESS) {
+		tini_add_error(ctx, value, NULL, rc);
+		put_text(j, value);
+		return;
+	}
+	put(j, tmp, n);
+}
+
+static void
+load(struct tini_json *j, struct tini_ctx *ctx,
+		const struct tini *name, const struct tini *label)
+{
+	j->section = (struct tini_section){ 0 };
+	j->loaded = true;
+	if (ctx->load_section &&
+			ctx->load_section(&j->section, name, label, ctx->udata) != TINI_SUCCESS) {
+		// sections the callback rejects are written untyped
+		j->section = (struct tini_section){ 0 };
+	}
+}
+
+static void
+json_section(struct tini_json *j, struct tini_ctx *ctx,
+		const struct tini *name, const struct tini *label)
+{
+	load(j, ctx, name, label);
+
+	if (j->format == TINI_JSON_LINES) {
+		size_t need = name->length + (label ? label->length : 0);
+		if (need > j->namecap) {
+			char *p = realloc(j->name, need);
+			if (p == NULL) {
+				j->failed = true;
+				return;
+			}
+			j->name = p;
+			j->namecap = need;
+		}
+		memcpy(j->name, name->start, name->length);
+		if (label) {
+			memcpy(j->name + name->length, label->start, label->length);
+		}
+		j->namelen = name->length;
+		j->labellen = label ? label->length : 0;
+		j->labelled = label != NULL;
+		return;
+	}
+
+	if (j->open) { PUTS(j, "}"); }
+	if (j->count++ > 0) { PUTS(j, ","); }
+	PUTS(j, "\"");
+	put_escaped(j, name->start, name->length);
+	if (label) {
+		PUTS(j, ":");
+		put_escaped(j, label->start, label->length);
+	}
+	PUTS(j, "\":{");
+	j->open = true;
+	j->nested = 0;
+}
+
+static void
+json_value(struct tini_json *j, struct tini_ctx *ctx,
+		const struct tini *key, const struct tini *value)
+{
+	if (!j->loaded) {
+		struct tini global = { .start = ctx->txt, .length = 0, .type = TINI_SECTION };
+		load(j, ctx, &global, NULL);
+	}
+
+	if (j->format == TINI_JSON_LINES) {
+		PUTS(j, "{\"section\":");
+		put_string(j, j->name, j->namelen);
+		if (j->labelled) {
+			PUTS(j, ",\"label\":");
+			put_string(j, j->name + j->namelen, j->labellen);
+		}
+		PUTS(j, ",\"key\":");
+		put_string(j, key->start, key->length);
+		PUTS(j, ",\"value\":");
+		put_value(j, ctx, key, value);
+		PUTS(j, "}\n");
+		return;
+	}
+
+	if ((j->open ? j->nested++ : j->count++) > 0) { PUTS(j, ","); }
+	put_string(j, key->start, key->length);
+	PUTS(j, ":");
+	put_value(j, ctx, key, value);
+}
+
+void
+tini_json_begin(struct tini_json *j, enum tini_json_format format,
+		char *buf, size_t len,
+		int (*write)(const char *buf, size_t len, void *udata),
+		void *udata)
+{
+	*j = (struct tini_json){
+		.buf = buf,
+		.len = len,
+		.write = write,
+		.udata = udata,
+		.format = format,
+	};
+	if (format == TINI_JSON_OBJECT) {
+		PUTS(j, "{");
+	}
+}
+
+enum tini_result
+tini_json_feed(struct tini_json *j, struct tini_ctx *ctx,
+		const char *txt, size_t txtlen,
+		int flags)
+{
+	struct tini_iter it;
+	struct tini_event ev;
+	const char *checked = txt;
+	enum tini_result rc;
+
+	ctx->txt = txt;
+	ctx->txtlen = txtlen;
+	ctx->txtline = 0;
+	ctx->nerr = 0;
+	ctx->cursor = NULL;
+
+	tini_iter_init(&it, txt, txtlen);
+	it.flags = flags;
+	while (!j->failed && tini_next(&it, &ev)) {
+		if (flags & TINI_VALIDATE) {
+			// JSON must be UTF-8, so invalid text is reported rather than copied
+			const char *end = ev.type == TINI_EVENT_ERROR ? ev.name.start : it.p;
+			const char *bad = tini_validate(checked, end, &rc);
+			if (bad != NULL) {
+				struct tini node = { .start = bad, .length = 1, .type = TINI_NONE };
+				tini_add_error(ctx, &node, NULL, rc);
+				break;
+			}
+			checked = end;
+		}
+
+		switch (ev.type) {
+		case TINI_EVENT_SECTION:
+			json_section(j, ctx, &ev.name,
+					ev.value.type == TINI_LABEL ? &ev.value : NULL);
+			break;
+		case TINI_EVENT_VALUE:
+			json_value(j, ctx, &ev.name, &ev.value);
+			break;
+		case TINI_EVENT_ERROR:
+			tini_add_error(ctx, &ev.name, NULL, ev.code);
+			if (flags & TINI_RECOVER) {
+				tini_iter_recover(&it);
+				checked = it.p;
+			}
+			break;
+		case TINI_EVENT_NONE:
+			break;
+		}
+	}
+
+	if ((flags & TINI_VALIDATE) && ctx->nerr == 0 && !j->failed) {
+		const char *bad = tini_validate(checked, txt + txtlen, &rc);
+		if (bad != NULL) {
+			struct tini node = { .start = bad, .length = 1, .type = TINI_NONE };
+			tini_add_error(ctx, &node, NULL, rc);
+		}
+	}
+
+	if (j->failed) {
+		return TINI_OUTPUT_ERROR;
+	}
+	return ctx->nerr ? ctx->err[0].code : TINI_SUCCESS;
+}
+
+enum tini_result
+tini_json_end(struct tini_json *j)
+{
+	if (j->format == TINI_JSON_OBJECT) {
+		if (j->open) { PUTS(j, "}"); }
+		PUTS(j, "}\n");
+	}
+	flush(j);
+	free(j->name);
+	j->name = NULL;
+	j->namecap = 0;
+	return j->failed ? TINI_OUTPUT_ERROR : TINI_SUCCESS;
+}
@@ -1,4 +1,5 @@
 #include "../include/tini.h"
+#include "segment.h"
 
 #include <inttypes.h>
 #include <stdlib.h>
@@ -10,16 +11,106 @@ tini_eq(const struct tini *node, const char *val, size_t len)
 		memcmp(node->start, val, len) == 0;
 }
 
+static inline const char *
+skip_indent(const char *p, const char *pe)
+{
+	while (p < pe && (*p == ' ' || *p == '\t')) { p++; }
+	return p;
+}
+
+bool
+tini_segment(const struct tini *value, const char **cursor, struct tini *seg)
+{
+	const char *p = *cursor, *pe = value->start + value->length;
+	bool first = p == NULL;
+	if (first) { p = value->start; }
+
+	if (value->type != TINI_CONTINUED) {
+		*cursor = pe;
+		*seg = (struct tini){ .start = p, .length = pe - p, .type = TINI_VALUE };
+		return first && p < pe;
+	}
+
+	const char *nl = memchr(value->start, '\n', value->length);
+	if (first && nl && tini_heredoc_tag(value->start, nl) > 0) {
+		// the body runs from the opening line to the terminator line
+		const char *last = memrchr(value->start, '\n', value->length);
+		*cursor = pe;
+		*seg = (struct tini){ .start = nl + 1, .length = last - nl - 1, .type = TINI_VALUE };
+		return last > nl;
+	}
+
+	while (p < pe) {
+		// a line that did not end in a backslash is joined by its newline
+		if (!first && *p == '\n') {
+			*seg = (struct tini){ .start = p, .length = 1, .type = TINI_VALUE };
+			*cursor = skip_indent(p + 1, pe);
+			return true;
+		}
+		first = false;
+
+		const char *bol = p;
+		const char *eol = memchr(p, '\n', pe - p);
+		if (eol == NULL) { eol = pe; }
+		size_t backslash = tini_continuation(bol, eol);
+		p = backslash ? skip_indent(eol + (eol < pe), pe) : eol;
+		*cursor = p;
+
+		const char *end = eol - backslash;
+		if (end > bol) {
+			*seg = (struct tini){ .start = bol, .length = end - bol, .type = TINI_VALUE };
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t
+tini_length(const struct tini *value)
+{
+	if (value->type != TINI_CONTINUED) {
+		return value->length;
+	}
+	const char *cursor = NULL;
+	struct tini seg;
+	size_t n = 0;
+	while (tini_segment(value, &cursor, &seg)) {
+		n += seg.length;
+	}
+	return n;
+}
+
 enum tini_result
 tini_str(char *t, size_t len, const struct tini *value)
 {
-	size_t vlen = value->length;
-	if (value && vlen < len) {
-		memcpy(t, value->start, vlen);
-		t[vlen] = '\0';
-		return TINI_SUCCESS;
+	if (value == NULL) {
+		return TINI_STRING_TOO_BIG;
+	}
+	if (value->type != TINI_CONTINUED) {
+		size_t vlen = value->length;
+		if (vlen < len) {
+			memcpy(t, value->start, vlen);
+			t[vlen] = '\0';
+			return TINI_SUCCESS;
+		}
+		return TINI_STRING_TOO_BIG;
+	}
+
+	// segments are copied straight into the target, which is left as an
+	// empty string if they do not fit
+	const char *cursor = NULL;
+	struct tini seg;
+	size_t n = 0;
+	while (tini_segment(value, &cursor, &seg)) {
+		if (seg.length >= len - n) {
+			if (len > 0) { *t = '\0'; }
+			return TINI_STRING_TOO_BIG;
+		}
+		memcpy(t + n, seg.start, seg.length);
+		n += seg.length;
 	}
-	return TINI_STRING_TOO_BIG;
+	t[n] = '\0';
+	return TINI_SUCCESS;
 }
 
 enum tini_result
@@ -84,11 +175,10 @@ tini_double(double *t, const struct tini *value)
 char *
 tini_copy(const struct tini *value)
 {
-	size_t len = value->length;
+	size_t len = tini_length(value);
 	char *c = malloc(len + 1);
 	if (c) {
-		memcpy(c, value->start, len);
-		c[len] = '\0';
+		tini_str(c, len + 1, value);
 	}
 	return c;
 }
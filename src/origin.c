@@ -0,0 +1,39 @@
+#include "../include/tini.h"
+
+_Static_assert(sizeof(struct tini_origin) == 8, "origins should stay compact");
+
+const struct tini_origin *
+tini_origin_find(const struct tini_origin *origins,
+		const struct tini_field *fields, size_t nfields,
+		const char *name)
+{
+	for (size_t i = 0; i < nfields; i++) {
+		if (strcmp(fields[i].name, name) == 0) {
+			return origins[i].line ? &origins[i] : NULL;
+		}
+	}
+	return NULL;
+}
+
+void
+tini_print_origins(const char *section,
+		const struct tini_origin *origins,
+		const struct tini_field *fields, size_t nfields,
+		const char *const *files, FILE *out)
+{
+	for (size_t i = 0; i < nfields; i++) {
+		const struct tini_origin *o = &origins[i];
+		if (o->line == 0) { continue; }
+
+		if (section && *section) {
+			fprintf(out, "%s.", section);
+		}
+		if (files) {
+			fprintf(out, "%s: %s:%u", fields[i].name, files[o->file], o->line);
+		}
+		else {
+			fprintf(out, "%s: #%u:%u", fields[i].name, o->file, o->line);
+		}
+		fprintf(out, " (layer %u)\n", o->layer);
+	}
+}
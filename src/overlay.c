@@ -0,0 +1,541 @@
+#include "../include/tini.h"
+#include "phash.h"
+#include "bind.h"
+
+#include <stdlib.h>
+#include <errno.h>
+
+#define NONE UINT32_MAX
+
+/**
+ * A distinct section, identified by its name and label. The keys set in it
+ * by any layer form a list in order of first appearance, which is the order
+ * they are bound in.
+ */
+struct section
+{
+	uint32_t name;
+	uint32_t namelen;
+	uint32_t label;
+	uint32_t labellen;
+	bool labelled;
+	uint32_t mask;
+	uint32_t first;
+	uint32_t last;
+};
+
+/**
+ * A distinct key within a section. `mask` has a bit for each layer that sets
+ * it, so the winning layer is its highest bit.
+ */
+struct slot
+{
+	uint32_t section;
+	uint32_t key;
+	uint32_t keylen;
+	uint32_t mask;
+	uint32_t next;
+};
+
+struct header
+{
+	struct tini_span name;
+	struct tini_span label;
+};
+
+struct value
+{
+	struct tini_span key;
+	struct tini_span value;
+};
+
+struct layer
+{
+	const char *txt;
+	size_t txtlen;
+	uint16_t file;
+	// the sections and slots this layer sets, for clearing it on replacement
+	uint32_t *sections;
+	size_t nsections;
+	uint32_t *slots;
+	size_t nslots;
+};
+
+struct table
+{
+	uint32_t *tab;
+	size_t mask;
+	size_t count;
+};
+
+struct tini_overlay
+{
+	unsigned nlayers;
+	struct layer layers[TINI_OVERLAY_MAX];
+	struct section *sections;
+	uint32_t nsections;
+	uint32_t seccap;
+	struct slot *slots;
+	uint32_t nslots;
+	uint32_t slotcap;
+	// per layer headers and values, `nlayers` entries for each section and slot
+	struct header *headers;
+	struct value *values;
+	struct table secindex;
+	struct table slotindex;
+	char *names;
+	size_t nameslen;
+	size_t namescap;
+};
+
+static inline unsigned
+winner(uint32_t mask)
+{
+	return 31 - __builtin_clz(mask);
+}
+
+static uint64_t
+section_hash(const char *name, size_t namelen,
+		const char *label, size_t labellen, bool labelled)
+{
+	return tini_hash(name, namelen, labelled ? tini_hash(label, labellen, 1) : 0);
+}
+
+static uint64_t
+slot_hash(uint32_t section, const char *key, size_t keylen)
+{
+	return tini_hash(key, keylen, (uint64_t)section + 1);
+}
+
+static int
+table_grow(struct table *t, const struct tini_overlay *ov, bool sections)
+{
+	if ((t->count + 1) * 2 <= t->mask + 1 && t->tab) {
+		return 0;
+	}
+
+	size_t n = t->tab ? (t->mask + 1) * 2 : 64;
+	uint32_t *tab = calloc(n, sizeof(*tab));
+	if (tab == NULL) { return -1; }
+
+	for (size_t i = 0; t->tab && i <= t->mask; i++) {
+		uint32_t id = t->tab[i];
+		if (id == 0) { continue; }
+		uint64_t h;
+		if (sections) {
+			const struct section *s = &ov->sections[id - 1];
+			h = section_hash(ov->names + s->name, s->namelen,
+					ov->names + s->label, s->labellen, s->labelled);
+		}
+		else {
+			const struct slot *s = &ov->slots[id - 1];
+			h = slot_hash(s->section, ov->names + s->key, s->keylen);
+		}
+		size_t j = h & (n - 1);
+		while (tab[j]) { j = (j + 1) & (n - 1); }
+		tab[j] = id;
+	}
+	free(t->tab);
+	t->tab = tab;
+	t->mask = n - 1;
+	return 0;
+}
+
+static uint32_t
+intern(struct tini_overlay *ov, const char *s, size_t n)
+{
+	if (ov->names == NULL || ov->nameslen + n > ov->namescap) {
+		size_t cap = ov->namescap ? ov->namescap * 2 : 1024;
+		while (cap < ov->nameslen + n) { cap *= 2; }
+		char *names = realloc(ov->names, cap);
+		if (names == NULL) { return NONE; }
+		ov->names = names;
+		ov->namescap = cap;
+	}
+	uint32_t off = ov->nameslen;
+	if (n > 0) { memcpy(ov->names + off, s, n); }
+	ov->nameslen += n;
+	return off;
+}
+
+static bool
+name_eq(const struct tini_overlay *ov, uint32_t off, uint32_t len,
+		const char *s, size_t n)
+{
+	return len == n && (n == 0 || memcmp(ov->names + off, s, n) == 0);
+}
+
+static uint32_t
+section_find(const struct tini_overlay *ov,
+		const char *name, size_t namelen,
+		const char *label, size_t labellen, bool labelled,
+		size_t *pos)
+{
+	const struct table *t = &ov->secindex;
+	if (t->tab == NULL) { return NONE; }
+
+	size_t i = section_hash(name, namelen, label, labellen, labelled) & t->mask;
+	for (; t->tab[i]; i = (i + 1) & t->mask) {
+		const struct section *s = &ov->sections[t->tab[i] - 1];
+		if (s->labelled == labelled &&
+				name_eq(ov, s->name, s->namelen, name, namelen) &&
+				name_eq(ov, s->label, s->labellen, label, labellen)) {
+			return t->tab[i] - 1;
+		}
+	}
+	if (pos) { *pos = i; }
+	return NONE;
+}
+
+static uint32_t
+slot_find(const struct tini_overlay *ov, uint32_t section,
+		const char *key, size_t keylen, size_t *pos)
+{
+	const struct table *t = &ov->slotindex;
+	if (t->tab == NULL) { return NONE; }
+
+	size_t i = slot_hash(section, key, keylen) & t->mask;
+	for (; t->tab[i]; i = (i + 1) & t->mask) {
+		const struct slot *s = &ov->slots[t->tab[i] - 1];
+		if (s->section == section && name_eq(ov, s->key, s->keylen, key, keylen)) {
+			return t->tab[i] - 1;
+		}
+	}
+	if (pos) { *pos = i; }
+	return NONE;
+}
+
+static uint32_t
+section_add(struct tini_overlay *ov, const struct tini *name, const struct tini *label)
+{
+	const char *l = label ? label->start : NULL;
+	size_t llen = label ? label->length : 0;
+	size_t pos;
+
+	uint32_t id = section_find(ov, name->start, name->length, l, llen, label, NULL);
+	if (id != NONE) { return id; }
+
+	if (ov->nsections == ov->seccap) {
+		uint32_t cap = ov->seccap ? ov->seccap * 2 : 16;
+		struct section *sections = realloc(ov->sections, cap * sizeof(*sections));
+		if (sections == NULL) { return NONE; }
+		ov->sections = sections;
+		struct header *headers = realloc(ov->headers,
+				(size_t)cap * ov->nlayers * sizeof(*headers));
+		if (headers == NULL) { return NONE; }
+		ov->headers = headers;
+		ov->seccap = cap;
+	}
+	if (table_grow(&ov->secindex, ov, true) < 0) { return NONE; }
+
+	uint32_t noff = intern(ov, name->start, name->length);
+	uint32_t loff = intern(ov, l, llen);
+	if (noff == NONE || loff == NONE) { return NONE; }
+
+	id = ov->nsections++;
+	ov->sections[id] = (struct section){
+		.name = noff,
+		.namelen = name->length,
+		.label = loff,
+		.labellen = llen,
+		.labelled = label != NULL,
+		.first = NONE,
+		.last = NONE,
+	};
+	(void)section_find(ov, name->start, name->length, l, llen, label, &pos);
+	ov->secindex.tab[pos] = id + 1;
+	ov->secindex.count++;
+	return id;
+}
+
+static uint32_t
+slot_add(struct tini_overlay *ov, uint32_t section, const struct tini *key)
+{
+	size_t pos;
+
+	uint32_t id = slot_find(ov, section, key->start, key->length, NULL);
+	if (id != NONE) { return id; }
+
+	if (ov->nslots == ov->slotcap) {
+		uint32_t cap = ov->slotcap ? ov->slotcap * 2 : 64;
+		struct slot *slots = realloc(ov->slots, cap * sizeof(*slots));
+		if (slots == NULL) { return NONE; }
+		ov->slots = slots;
+		struct value *values = realloc(ov->values,
+				(size_t)cap * ov->nlayers * sizeof(*values));
+		if (values == NULL) { return NONE; }
+		ov->values = values;
+		ov->slotcap = cap;
+	}
+	if (table_grow(&ov->slotindex, ov, false) < 0) { return NONE; }
+
+	uint32_t koff = intern(ov, key->start, key->length);
+	if (koff == NONE) { return NONE; }
+
+	id = ov->nslots++;
+	ov->slots[id] = (struct slot){
+		.section = section,
+		.key = koff,
+		.keylen = key->length,
+		.next = NONE,
+	};
+	struct section *s = &ov->sections[section];
+	if (s->last == NONE) { s->first = id; }
+	else { ov->slots[s->last].next = id; }
+	s->last = id;
+
+	(void)slot_find(ov, section, key->start, key->length, &pos);
+	ov->slotindex.tab[pos] = id + 1;
+	ov->slotindex.count++;
+	return id;
+}
+
+static int
+push(uint32_t **ids, size_t *n, size_t *cap, uint32_t id)
+{
+	if (*n == *cap) {
+		size_t c = *cap ? *cap * 2 : 32;
+		uint32_t *p = realloc(*ids, c * sizeof(*p));
+		if (p == NULL) { return -1; }
+		*ids = p;
+		*cap = c;
+	}
+	(*ids)[(*n)++] = id;
+	return 0;
+}
+
+struct tini_overlay *
+tini_overlay_new(unsigned nlayers)
+{
+	if (nlayers == 0 || nlayers > TINI_OVERLAY_MAX) {
+		errno = EINVAL;
+		return NULL;
+	}
+	struct tini_overlay *ov = calloc(1, sizeof(*ov));
+	if (ov != NULL) {
+		ov->nlayers = nlayers;
+	}
+	return ov;
+}
+
+void
+tini_overlay_free(struct tini_overlay *ov)
+{
+	if (ov == NULL) { return; }
+	for (unsigned i = 0; i < ov->nlayers; i++) {
+		free(ov->layers[i].sections);
+		free(ov->layers[i].slots);
+	}
+	free(ov->sections);
+	free(ov->slots);
+	free(ov->headers);
+	free(ov->values);
+	free(ov->secindex.tab);
+	free(ov->slotindex.tab);
+	free(ov->names);
+	free(ov);
+}
+
+enum tini_result
+tini_overlay_set(struct tini_overlay *ov, struct tini_ctx *ctx,
+		unsigned layer, const char *txt, size_t txtlen,
+		int flags)
+{
+	struct layer next = { .txt = txt, .txtlen = txtlen, .file = ctx->file };
+	size_t seccap = 0, slotcap = 0;
+	struct tini_iter it;
+	struct tini_event ev;
+	uint32_t section = NONE;
+
+	ctx->txt = txt;
+	ctx->txtlen = txtlen;
+	ctx->txtline = 0;
+	ctx->nerr = 0;
+	ctx->cursor = NULL;
+
+	if (layer >= ov->nlayers) {
+		return TINI_INVALID_TYPE;
+	}
+
+	if (flags & TINI_VALIDATE) {
+		const char *p = txt, *pe = txt + txtlen;
+		enum tini_result rc;
+		while ((p = tini_validate(p, pe, &rc)) != NULL) {
+			struct tini node = { .start = p, .length = 1, .type = TINI_NONE };
+			tini_add_error(ctx, &node, NULL, rc);
+			for (p++; rc == TINI_INVALID_UTF8 && p < pe && (*p & 0xc0) == 0x80; p++) {}
+		}
+	}
+
+	// the layer is indexed first and only replaces the old one once it parsed
+	// cleanly; slots added for a rejected layer stay empty
+	struct header *h = NULL;
+	tini_iter_init(&it, txt, txtlen);
+	while (ctx->nerr == 0 && tini_next(&it, &ev)) {
+		switch (ev.type) {
+		case TINI_EVENT_SECTION: {
+			const struct tini *label = ev.value.type == TINI_LABEL ? &ev.value : NULL;
+			section = section_add(ov, &ev.name, label);
+			if (section == NONE || push(&next.sections, &next.nsections, &seccap, section) < 0) {
+				tini_add_error(ctx, &ev.name, NULL, TINI_NO_MEMORY);
+				break;
+			}
+			break;
+		}
+		case TINI_EVENT_VALUE:
+			if (section == NONE) {
+				struct tini global = { .start = txt, .length = 0, .type = TINI_SECTION };
+				section = section_add(ov, &global, NULL);
+				if (section == NONE || push(&next.sections, &next.nsections, &seccap, section) < 0) {
+					tini_add_error(ctx, &ev.name, NULL, TINI_NO_MEMORY);
+					break;
+				}
+			}
+			uint32_t slot = slot_add(ov, section, &ev.name);
+			if (slot == NONE || push(&next.slots, &next.nslots, &slotcap, slot) < 0) {
+				tini_add_error(ctx, &ev.name, NULL, TINI_NO_MEMORY);
+			}
+			break;
+		case TINI_EVENT_ERROR:
+			tini_add_error(ctx, &ev.name, NULL, ev.code);
+			break;
+		case TINI_EVENT_NONE:
+			break;
+		}
+	}
+
+	if (ctx->nerr > 0) {
+		free(next.sections);
+		free(next.slots);
+		return ctx->err[0].code;
+	}
+
+	// only the slots touched by the old and new text change their masks
+	uint32_t bit = UINT32_C(1) << layer;
+	struct layer *old = &ov->layers[layer];
+	for (size_t i = 0; i < old->nsections; i++) {
+		ov->sections[old->sections[i]].mask &= ~bit;
+	}
+	for (size_t i = 0; i < old->nslots; i++) {
+		ov->slots[old->slots[i]].mask &= ~bit;
+	}
+	free(old->sections);
+	free(old->slots);
+	*old = next;
+
+	// the ids were recorded in text order, so a second pass over the events
+	// pairs each one with its source spans without searching the index again
+	size_t si = 0, vi = 0;
+	tini_iter_init(&it, txt, txtlen);
+	while (tini_next(&it, &ev)) {
+		if (ev.type == TINI_EVENT_SECTION || (ev.type == TINI_EVENT_VALUE && si == 0)) {
+			uint32_t id = next.sections[si++];
+			h = &ov->headers[(size_t)id * ov->nlayers + layer];
+			ov->sections[id].mask |= bit;
+			if (ev.type == TINI_EVENT_SECTION) {
+				h->name = tini_span_make(txt, &ev.name);
+				h->label = ev.value.type == TINI_LABEL ?
+					tini_span_make(txt, &ev.value) : (struct tini_span){ 0, 0 };
+				continue;
+			}
+			h->name = h->label = (struct tini_span){ 0, 0 };
+		}
+		if (ev.type == TINI_EVENT_VALUE) {
+			uint32_t id = next.slots[vi++];
+			ov->slots[id].mask |= bit;
+			ov->values[(size_t)id * ov->nlayers + layer] = (struct value){
+				tini_span_make(txt, &ev.name),
+				tini_span_make(txt, &ev.value),
+			};
+		}
+	}
+	return TINI_SUCCESS;
+}
+
+int
+tini_overlay_get(const struct tini_overlay *ov,
+		const char *section, const char *label, const char *key,
+		struct tini *value)
+{
+	uint32_t sid = section_find(ov, section, strlen(section),
+			label, label ? strlen(label) : 0, label != NULL, NULL);
+	if (sid == NONE) { return -1; }
+	uint32_t id = slot_find(ov, sid, key, strlen(key), NULL);
+	if (id == NONE || ov->slots[id].mask == 0) { return -1; }
+
+	unsigned l = winner(ov->slots[id].mask);
+	if (value) {
+		*value = tini_span_node(ov->layers[l].txt,
+				ov->values[(size_t)id * ov->nlayers + l].value, TINI_VALUE);
+	}
+	return l;
+}
+
+struct cursor
+{
+	const struct tini_overlay *ov;
+	struct tini_ctx *ctx;
+	uint32_t section;
+	uint32_t slot;
+	bool opened;
+};
+
+static bool
+next_event(struct tini_event *ev, struct tini_source *src, void *udata)
+{
+	struct cursor *c = udata;
+	const struct tini_overlay *ov = c->ov;
+
+	for (; c->section < ov->nsections; c->section++, c->opened = false) {
+		const struct section *s = &ov->sections[c->section];
+		if (s->mask == 0) { continue; }
+
+		if (!c->opened) {
+			unsigned l = winner(s->mask);
+			const struct header *h = &ov->headers[(size_t)c->section * ov->nlayers + l];
+			*src = (struct tini_source){ ov->layers[l].txt, ov->layers[l].txtlen, 0 };
+			*ev = (struct tini_event){
+				.type = TINI_EVENT_SECTION,
+				.name = tini_span_node(src->txt, h->name, TINI_SECTION),
+			};
+			if (s->labelled) {
+				ev->value = tini_span_node(src->txt, h->label, TINI_LABEL);
+			}
+			c->opened = true;
+			c->slot = s->first;
+			return true;
+		}
+
+		while (c->slot != NONE) {
+			const struct slot *slot = &ov->slots[c->slot];
+			uint32_t id = c->slot;
+			c->slot = slot->next;
+			if (slot->mask == 0) { continue; }
+
+			unsigned l = winner(slot->mask);
+			const struct value *v = &ov->values[(size_t)id * ov->nlayers + l];
+			*src = (struct tini_source){ ov->layers[l].txt, ov->layers[l].txtlen, 0 };
+			// origins name the layer that won and the file it was set from
+			c->ctx->file = ov->layers[l].file;
+			c->ctx->layer = l;
+			*ev = (struct tini_event){
+				.type = TINI_EVENT_VALUE,
+				.name = tini_span_node(src->txt, v->key, TINI_KEY),
+				.value = tini_span_node(src->txt, v->value, TINI_VALUE),
+			};
+			return true;
+		}
+	}
+	return false;
+}
+
+enum tini_result
+tini_overlay_bind(const struct tini_overlay *ov, struct tini_ctx *ctx, int flags)
+{
+	struct cursor c = { .ov = ov, .ctx = ctx };
+	uint16_t file = ctx->file, layer = ctx->layer;
+	enum tini_result rc = tini_bind_events(ctx, flags, next_event, &c);
+	ctx->file = file;
+	ctx->layer = layer;
+	return rc;
+}
@@ -1,166 +1,168 @@
 
 #line 1 "src/parse.rl"
 #include "../include/tini.h"
+#include "segment.h"
 
 #include <stddef.h>
 #include <string.h>
 #include <assert.h>
 
 
-#line 53 "src/parse.rl"
+#line 45 "src/parse.rl"
 
 
-static const struct tini *
-select_error(const struct tini *key, const struct tini *value, enum tini_result rc)
+// line and column are located on demand, see tini_locate
+#define SET(n, t) do { \
+	(n) = (struct tini){ .start = mark, .length = p - mark, .type = (t) }; \
+} while (0)
+
+void
+tini_iter_init(struct tini_iter *it, const char *txt, size_t txtlen)
 {
-	switch (rc) {
-	case TINI_SUCCESS: return NULL;
-	case TINI_SYNTAX: return key;
-	case TINI_STRING_TOO_BIG: return value;
-	case TINI_BOOL_FORMAT: return value;
-	case TINI_INTEGER_FORMAT: return value;
-	case TINI_INTEGER_TOO_SMALL: return value;
-	case TINI_INTEGER_TOO_BIG: return value;
-	case TINI_INTEGER_NEGATIVE: return value;
-	case TINI_NUMBER_FORMAT: return value;
-	case TINI_INVALID_TYPE: return value;
-	case TINI_UNUSED_SECTION: return key;
-	case TINI_UNUSED_KEY: return key;
-	case TINI_MISSING_SECTION: return key;
-	case TINI_MISSING_KEY: return key;
-	}
-	return key;
+	it->txt = txt;
+	it->p = txt;
+	it->pe = txt + txtlen;
+	it->mark = txt;
+	it->located = txt;
+	it->line = 0;
+	it->flags = 0;
+	it->cs = 13;
 }
 
-#define SECTION() do { \
-	load.nfields = 0; \
-	load.target = NULL; \
-	load.assign = tini_assign; \
-	enum tini_result rc = ctx->load_section ? \
-		ctx->load_section(&load, &section, labelp, ctx->udata) : \
-		TINI_UNUSED_SECTION; \
-	has_section = rc == TINI_SUCCESS; \
-	if (!has_section) { \
-		tini_add_error(ctx, &section, NULL, rc); \
-	} \
-} while (0)
+/**
+ * Extends a value over the lines that continue it. A heredoc value runs to
+ * its terminator line; otherwise a line ending in a backslash or followed by
+ * an indented line continues onto the next one. Returns false for a heredoc
+ * without a terminator.
+ */
+static bool
+continue_value(struct tini_iter *it, struct tini *value)
+{
+	const char *p = it->p, *pe = it->pe;
+	const char *end = value->start + value->length;
 
-#define SET(n) do { \
-	(n).start = mark; \
-	(n).length = p - mark; \
-	(n).line_start = bol; \
-	(n).line = line; \
-	(n).column = mark - bol; \
-} while (0)
+	size_t taglen = tini_heredoc_tag(value->start, end);
+	if (taglen > 0) {
+		const char *tag = value->start + 2;
+		while (p < pe) {
+			const char *bol = p;
+			const char *nl = memchr(p, '\n', pe - p);
+			const char *eol = nl ? nl : pe;
+			p = nl ? nl + 1 : pe;
+			if ((size_t)(eol - bol) == taglen && memcmp(bol, tag, taglen) == 0) {
+				value->length = eol - value->start;
+				value->type = TINI_CONTINUED;
+				it->p = p;
+				return true;
+			}
+		}
+		return false;
+	}
 
-#define BAIL(c) do { \
-	rc = (c); \
-	goto done; \
-} while (0)
+	for (;;) {
+		bool backslash = tini_continuation(value->start, end) > 0;
+		if (p >= pe || (!backslash && *p != ' ' && *p != '\t')) { break; }
 
-enum tini_result
-tini_parse(struct tini_ctx *ctx,
-		const char *txt, size_t txtlen,
-		int flags)
-{
-	(void)flags;
+		// an indented line continues the value only if it is not blank
+		const char *nl = memchr(p, '\n', pe - p);
+		if (nl == NULL) { break; }
+		if (!backslash) {
+			const char *c = p;
+			while (c < nl && (*c == ' ' || *c == '\t')) { c++; }
+			if (c == nl) { break; }
+		}
+		end = nl;
+		p = nl + 1;
+	}
+
+	if (end != value->start + value->length) {
+		value->length = end - value->start;
+		value->type = TINI_CONTINUED;
+		it->p = p;
+	}
+	return true;
+}
 
-	const char *p = txt;
-	const char *pe = p + txtlen;
-	const char *mark = p;
-	const char *bol = p;
-	size_t line = 0;
-	int cs = 13;
+void
+tini_iter_recover(struct tini_iter *it)
+{
+	// the iterator stopped on the offending byte, which may be the newline
+	const char *nl = it->p < it->pe ? memchr(it->p, '\n', it->pe - it->p) : NULL;
+	it->p = nl ? nl + 1 : it->pe;
+	it->mark = it->p;
+	it->cs = 13;
+}
 
-	struct tini section = { .type = TINI_SECTION };
-	struct tini label = { .type = TINI_LABEL };
-	struct tini key = { .type = TINI_KEY };
-	struct tini value = { .type = TINI_VALUE };
-	struct tini *labelp = NULL;
-	bool global_section = true;
-	bool has_section = false; 
+bool
+tini_next(struct tini_iter *it, struct tini_event *ev)
+{
+	const char *p = it->p;
+	const char *pe = it->pe;
+	const char *mark = it->mark;
+	int cs = it->cs;
 
-	struct tini_section load = {};
+	if (cs == 0) {
+		return false;
+	}
 
-	ctx->txt = txt;
-	ctx->txtlen = txtlen;
-	ctx->nerr = 0;
+	ev->type = TINI_EVENT_NONE;
 
 	
-#line 91 "src/parse.c"
+#line 112 "src/parse.c"
 	{
 	if ( p == pe )
 		goto _test_eof;
 	switch ( cs )
 	{
 tr1:
-#line 12 "src/parse.rl"
+#line 25 "src/parse.rl"
 	{
-		bol = p + 1;
-		line++;
+		if (ev->type != TINI_EVENT_NONE) {
+			{p++; cs = 13; goto _out;}
+		}
 	}
 	goto st13;
 tr10:
-#line 10 "src/parse.rl"
+#line 11 "src/parse.rl"
 	{ mark = p; }
 #line 20 "src/parse.rl"
-	{ SET(value); }
-#line 27 "src/parse.rl"
+	{ SET(ev->value, TINI_VALUE); }
+#line 23 "src/parse.rl"
+	{ ev->type = TINI_EVENT_VALUE; }
+#line 25 "src/parse.rl"
 	{
-		if (global_section && !has_section) {
-			SECTION();
+		if (ev->type != TINI_EVENT_NONE) {
+			{p++; cs = 13; goto _out;}
 		}
-		enum tini_result rc = load.assign ?
-			load.assign(&load, &key, &value, ctx->udata) :
-			TINI_UNUSED_SECTION;
-		if (rc != TINI_SUCCESS) {
-			tini_add_error(ctx, select_error(&key, &value, rc), NULL, rc);
-		}
-	}
-#line 12 "src/parse.rl"
-	{
-		bol = p + 1;
-		line++;
 	}
 	goto st13;
 tr12:
 #line 20 "src/parse.rl"
-	{ SET(value); }
-#line 27 "src/parse.rl"
+	{ SET(ev->value, TINI_VALUE); }
+#line 23 "src/parse.rl"
+	{ ev->type = TINI_EVENT_VALUE; }
+#line 25 "src/parse.rl"
 	{
-		if (global_section && !has_section) {
-			SECTION();
+		if (ev->type != TINI_EVENT_NONE) {
+			{p++; cs = 13; goto _out;}
 		}
-		enum tini_result rc = load.assign ?
-			load.assign(&load, &key, &value, ctx->udata) :
-			TINI_UNUSED_SECTION;
-		if (rc != TINI_SUCCESS) {
-			tini_add_error(ctx, select_error(&key, &value, rc), NULL, rc);
-		}
-	}
-#line 12 "src/parse.rl"
-	{
-		bol = p + 1;
-		line++;
 	}
 	goto st13;
 tr27:
 #line 22 "src/parse.rl"
+	{ ev->type = TINI_EVENT_SECTION; }
+#line 25 "src/parse.rl"
 	{
-		global_section = false;
-		SECTION();
-	}
-#line 12 "src/parse.rl"
-	{
-		bol = p + 1;
-		line++;
+		if (ev->type != TINI_EVENT_NONE) {
+			{p++; cs = 13; goto _out;}
+		}
 	}
 	goto st13;
 st13:
 	if ( ++p == pe )
 		goto _test_eof13;
 case 13:
-#line 164 "src/parse.c"
+#line 166 "src/parse.c"
 	switch( (*p) ) {
 		case 10: goto tr1;
 		case 35: goto st1;
@@ -191,14 +193,14 @@ case 1:
 		goto tr1;
 	goto st1;
 tr28:
-#line 10 "src/parse.rl"
+#line 11 "src/parse.rl"
 	{ mark = p; }
 	goto st2;
 st2:
 	if ( ++p == pe )
 		goto _test_eof2;
 case 2:
-#line 202 "src/parse.c"
+#line 204 "src/parse.c"
 	switch( (*p) ) {
 		case 9: goto tr2;
 		case 32: goto tr2;
@@ -222,13 +224,13 @@ case 2:
 	goto st0;
 tr2:
 #line 19 "src/parse.rl"
-	{ SET(key); }
+	{ SET(ev->name, TINI_KEY); }
 	goto st3;
 st3:
 	if ( ++p == pe )
 		goto _test_eof3;
 case 3:
-#line 232 "src/parse.c"
+#line 234 "src/parse.c"
 	switch( (*p) ) {
 		case 9: goto st3;
 		case 32: goto st3;
@@ -239,17 +241,17 @@ case 3:
 	goto st0;
 tr5:
 #line 19 "src/parse.rl"
-	{ SET(key); }
+	{ SET(ev->name, TINI_KEY); }
 	goto st4;
 tr9:
-#line 10 "src/parse.rl"
+#line 11 "src/parse.rl"
 	{ mark = p; }
 	goto st4;
 st4:
 	if ( ++p == pe )
 		goto _test_eof4;
 case 4:
-#line 253 "src/parse.c"
+#line 255 "src/parse.c"
 	switch( (*p) ) {
 		case 10: goto tr10;
 		case 32: goto tr9;
@@ -258,14 +260,14 @@ case 4:
 		goto tr9;
 	goto tr8;
 tr8:
-#line 10 "src/parse.rl"
+#line 11 "src/parse.rl"
 	{ mark = p; }
 	goto st5;
 st5:
 	if ( ++p == pe )
 		goto _test_eof5;
 case 5:
-#line 269 "src/parse.c"
+#line 271 "src/parse.c"
 	if ( (*p) == 10 )
 		goto tr12;
 	goto st5;
@@ -294,14 +296,14 @@ case 6:
 		goto tr14;
 	goto st0;
 tr14:
-#line 10 "src/parse.rl"
+#line 11 "src/parse.rl"
 	{ mark = p; }
 	goto st7;
 st7:
 	if ( ++p == pe )
 		goto _test_eof7;
 case 7:
-#line 305 "src/parse.c"
+#line 307 "src/parse.c"
 	switch( (*p) ) {
 		case 9: goto tr15;
 		case 32: goto tr15;
@@ -325,14 +327,17 @@ case 7:
 		goto st7;
 	goto st0;
 tr15:
-#line 17 "src/parse.rl"
-	{ SET(section); labelp = NULL; }
+#line 13 "src/parse.rl"
+	{
+		SET(ev->name, TINI_SECTION);
+		ev->value = (struct tini){ .type = TINI_NONE };
+	}
 	goto st8;
 st8:
 	if ( ++p == pe )
 		goto _test_eof8;
 case 8:
-#line 336 "src/parse.c"
+#line 341 "src/parse.c"
 	switch( (*p) ) {
 		case 9: goto st8;
 		case 32: goto st8;
@@ -343,14 +348,17 @@ case 8:
 		goto st8;
 	goto st0;
 tr17:
-#line 17 "src/parse.rl"
-	{ SET(section); labelp = NULL; }
+#line 13 "src/parse.rl"
+	{
+		SET(ev->name, TINI_SECTION);
+		ev->value = (struct tini){ .type = TINI_NONE };
+	}
 	goto st9;
 st9:
 	if ( ++p == pe )
 		goto _test_eof9;
 case 9:
-#line 354 "src/parse.c"
+#line 362 "src/parse.c"
 	switch( (*p) ) {
 		case 9: goto st9;
 		case 32: goto st9;
@@ -372,14 +380,14 @@ case 9:
 		goto tr22;
 	goto st0;
 tr22:
-#line 10 "src/parse.rl"
+#line 11 "src/parse.rl"
 	{ mark = p; }
 	goto st10;
 st10:
 	if ( ++p == pe )
 		goto _test_eof10;
 case 10:
-#line 383 "src/parse.c"
+#line 391 "src/parse.c"
 	switch( (*p) ) {
 		case 9: goto tr23;
 		case 32: goto tr23;
@@ -403,13 +411,13 @@ case 10:
 	goto st0;
 tr23:
 #line 18 "src/parse.rl"
-	{ SET(label); labelp = &label; }
+	{ SET(ev->value, TINI_LABEL); }
 	goto st11;
 st11:
 	if ( ++p == pe )
 		goto _test_eof11;
 case 11:
-#line 413 "src/parse.c"
+#line 421 "src/parse.c"
 	switch( (*p) ) {
 		case 9: goto st11;
 		case 32: goto st11;
@@ -419,18 +427,21 @@ case 11:
 		goto st11;
 	goto st0;
 tr18:
-#line 17 "src/parse.rl"
-	{ SET(section); labelp = NULL; }
+#line 13 "src/parse.rl"
+	{
+		SET(ev->name, TINI_SECTION);
+		ev->value = (struct tini){ .type = TINI_NONE };
+	}
 	goto st12;
 tr25:
 #line 18 "src/parse.rl"
-	{ SET(label); labelp = &label; }
+	{ SET(ev->value, TINI_LABEL); }
 	goto st12;
 st12:
 	if ( ++p == pe )
 		goto _test_eof12;
 case 12:
-#line 434 "src/parse.c"
+#line 445 "src/parse.c"
 	if ( (*p) == 10 )
 		goto tr27;
 	goto st0;
@@ -453,16 +464,40 @@ case 12:
 	_out: {}
 	}
 
-#line 132 "src/parse.rl"
+#line 144 "src/parse.rl"
 
-	if (cs < 13) {
-		p++;
-		SET(value);
-		value.length = 1;
-		value.type = TINI_NONE;
-		tini_add_error(ctx, &value, NULL, TINI_SYNTAX);
+	it->p = p;
+	it->mark = mark;
+	it->cs = cs;
+
+	if (ev->type == TINI_EVENT_VALUE && (it->flags & TINI_MULTILINE) &&
+			!continue_value(it, &ev->value)) {
+		// an unterminated heredoc is reported at its opening, and recovery
+		// resumes after that line
+		p = it->p = ev->value.start;
+		goto fail;
+	}
+	if (ev->type != TINI_EVENT_NONE) {
+		return true;
+	}
+	if (cs >= 13) {
+		return false;
 	}
 
-	return ctx->nerr ? ctx->err[0].code : TINI_SUCCESS;
+fail:
+	// report the syntax error once and stop the iterator until it recovers
+	ev->type = TINI_EVENT_ERROR;
+	ev->code = TINI_SYNTAX;
+	// point at the offending byte, or the last mark if the text ended early
+	if (p < pe) { mark = p; }
+	p++;
+	SET(ev->name, TINI_NONE);
+	ev->name.length = 1;
+	// errors are located from the previous one, so reporting many stays linear
+	tini_locate(it->located, &ev->name);
+	ev->name.line += it->line;
+	it->located = ev->name.line_start;
+	it->line = ev->name.line;
+	it->cs = 0;
+	return true;
 }
-
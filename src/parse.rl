@@ -1,4 +1,5 @@
 #include "../include/tini.h"
+#include "segment.h"
 
 #include <stddef.h>
 #include <string.h>
@@ -9,35 +10,26 @@
 
 	action mark { mark = p; }
 
-	action mark_line {
-		bol = p + 1;
-		line++;
+	action set_section {
+		SET(ev->name, TINI_SECTION);
+		ev->value = (struct tini){ .type = TINI_NONE };
 	}
 
-	action set_section { SET(section); labelp = NULL; }
-	action set_label   { SET(label); labelp = &label; }
-	action set_key     { SET(key); }
-	action set_value   { SET(value); }
+	action set_label   { SET(ev->value, TINI_LABEL); }
+	action set_key     { SET(ev->name, TINI_KEY); }
+	action set_value   { SET(ev->value, TINI_VALUE); }
 
-	action load_section {
-		global_section = false;
-		SECTION();
-	}
+	action emit_section { ev->type = TINI_EVENT_SECTION; }
+	action emit_value   { ev->type = TINI_EVENT_VALUE; }
 
-	action assign {
-		if (global_section && !has_section) {
-			SECTION();
-		}
-		enum tini_result rc = load.assign ?
-			load.assign(&load, &key, &value, ctx->udata) :
-			TINI_UNUSED_SECTION;
-		if (rc != TINI_SUCCESS) {
-			tini_add_error(ctx, select_error(&key, &value, rc), NULL, rc);
+	action yield {
+		if (ev->type != TINI_EVENT_NONE) {
+			fbreak;
 		}
 	}
 
 	ws      = [\t\v\f\r ];
-	nl      = '\n' >mark_line;
+	nl      = '\n';
 	name    = ( alpha | digit | '-' | '_' | '.' )+;
 	string  = ( name | ':' )+;
 	key     = string >mark %set_key;
@@ -47,97 +39,141 @@
 	slabel  = string >mark %set_label;
 	section = '[' ws* sname ws* ( ':' ws* slabel ws* )? ']';
 	field   = key ws* '=' ws* ( value >mark );
-	line    = ( comment | ( section %load_section ) | ( field %assign ) ) {,1} nl;
+	line    = ( comment | ( section %emit_section ) | ( field %emit_value ) ) {,1} nl @yield;
 
 	main := line*;
 }%%
 
-static const struct tini *
-select_error(const struct tini *key, const struct tini *value, enum tini_result rc)
+// line and column are located on demand, see tini_locate
+#define SET(n, t) do { \
+	(n) = (struct tini){ .start = mark, .length = p - mark, .type = (t) }; \
+} while (0)
+
+void
+tini_iter_init(struct tini_iter *it, const char *txt, size_t txtlen)
 {
-	switch (rc) {
-	case TINI_SUCCESS: return NULL;
-	case TINI_SYNTAX: return key;
-	case TINI_STRING_TOO_BIG: return value;
-	case TINI_BOOL_FORMAT: return value;
-	case TINI_INTEGER_FORMAT: return value;
-	case TINI_INTEGER_TOO_SMALL: return value;
-	case TINI_INTEGER_TOO_BIG: return value;
-	case TINI_INTEGER_NEGATIVE: return value;
-	case TINI_NUMBER_FORMAT: return value;
-	case TINI_INVALID_TYPE: return value;
-	case TINI_UNUSED_SECTION: return key;
-	case TINI_UNUSED_KEY: return key;
-	case TINI_MISSING_SECTION: return key;
-	case TINI_MISSING_KEY: return key;
-	}
-	return key;
+	it->txt = txt;
+	it->p = txt;
+	it->pe = txt + txtlen;
+	it->mark = txt;
+	it->located = txt;
+	it->line = 0;
+	it->flags = 0;
+	it->cs = %%{ write start; }%%;
 }
 
-#define SECTION() do { \
-	load.nfields = 0; \
-	load.target = NULL; \
-	load.assign = tini_assign; \
-	enum tini_result rc = ctx->load_section ? \
-		ctx->load_section(&load, &section, labelp, ctx->udata) : \
-		TINI_UNUSED_SECTION; \
-	has_section = rc == TINI_SUCCESS; \
-	if (!has_section) { \
-		tini_add_error(ctx, &section, NULL, rc); \
-	} \
-} while (0)
+/**
+ * Extends a value over the lines that continue it. A heredoc value runs to
+ * its terminator line; otherwise a line ending in a backslash or followed by
+ * an indented line continues onto the next one. Returns false for a heredoc
+ * without a terminator.
+ */
+static bool
+continue_value(struct tini_iter *it, struct tini *value)
+{
+	const char *p = it->p, *pe = it->pe;
+	const char *end = value->start + value->length;
+
+	size_t taglen = tini_heredoc_tag(value->start, end);
+	if (taglen > 0) {
+		const char *tag = value->start + 2;
+		while (p < pe) {
+			const char *bol = p;
+			const char *nl = memchr(p, '\n', pe - p);
+			const char *eol = nl ? nl : pe;
+			p = nl ? nl + 1 : pe;
+			if ((size_t)(eol - bol) == taglen && memcmp(bol, tag, taglen) == 0) {
+				value->length = eol - value->start;
+				value->type = TINI_CONTINUED;
+				it->p = p;
+				return true;
+			}
+		}
+		return false;
+	}
 
-#define SET(n) do { \
-	(n).start = mark; \
-	(n).length = p - mark; \
-	(n).line_start = bol; \
-	(n).line = line; \
-	(n).column = mark - bol; \
-} while (0)
+	for (;;) {
+		bool backslash = tini_continuation(value->start, end) > 0;
+		if (p >= pe || (!backslash && *p != ' ' && *p != '\t')) { break; }
+
+		// an indented line continues the value only if it is not blank
+		const char *nl = memchr(p, '\n', pe - p);
+		if (nl == NULL) { break; }
+		if (!backslash) {
+			const char *c = p;
+			while (c < nl && (*c == ' ' || *c == '\t')) { c++; }
+			if (c == nl) { break; }
+		}
+		end = nl;
+		p = nl + 1;
+	}
 
-#define BAIL(c) do { \
-	rc = (c); \
-	goto done; \
-} while (0)
+	if (end != value->start + value->length) {
+		value->length = end - value->start;
+		value->type = TINI_CONTINUED;
+		it->p = p;
+	}
+	return true;
+}
 
-enum tini_result
-tini_parse(struct tini_ctx *ctx,
-		const char *txt, size_t txtlen,
-		int flags)
+void
+tini_iter_recover(struct tini_iter *it)
 {
-	(void)flags;
-
-	const char *p = txt;
-	const char *pe = p + txtlen;
-	const char *mark = p;
-	const char *bol = p;
-	size_t line = 0;
-	int cs = %%{ write start; }%%;
+	// the iterator stopped on the offending byte, which may be the newline
+	const char *nl = it->p < it->pe ? memchr(it->p, '\n', it->pe - it->p) : NULL;
+	it->p = nl ? nl + 1 : it->pe;
+	it->mark = it->p;
+	it->cs = %%{ write start; }%%;
+}
 
-	struct tini section = { .type = TINI_SECTION };
-	struct tini label = { .type = TINI_LABEL };
-	struct tini key = { .type = TINI_KEY };
-	struct tini value = { .type = TINI_VALUE };
-	struct tini *labelp = NULL;
-	bool global_section = true;
-	bool has_section = false; 
+bool
+tini_next(struct tini_iter *it, struct tini_event *ev)
+{
+	const char *p = it->p;
+	const char *pe = it->pe;
+	const char *mark = it->mark;
+	int cs = it->cs;
 
-	struct tini_section load = {};
+	if (cs == %%{ write error; }%%) {
+		return false;
+	}
 
-	ctx->txt = txt;
-	ctx->txtlen = txtlen;
-	ctx->nerr = 0;
+	ev->type = TINI_EVENT_NONE;
 
 	%% write exec;
 
-	if (cs < %%{ write first_final; }%%) {
-		p++;
-		SET(value);
-		value.length = 1;
-		value.type = TINI_NONE;
-		tini_add_error(ctx, &value, NULL, TINI_SYNTAX);
+	it->p = p;
+	it->mark = mark;
+	it->cs = cs;
+
+	if (ev->type == TINI_EVENT_VALUE && (it->flags & TINI_MULTILINE) &&
+			!continue_value(it, &ev->value)) {
+		// an unterminated heredoc is reported at its opening, and recovery
+		// resumes after that line
+		p = it->p = ev->value.start;
+		goto fail;
+	}
+	if (ev->type != TINI_EVENT_NONE) {
+		return true;
+	}
+	if (cs >= %%{ write first_final; }%%) {
+		return false;
 	}
 
-	return ctx->nerr ? ctx->err[0].code : TINI_SUCCESS;
+fail:
+	// report the syntax error once and stop the iterator until it recovers
+	ev->type = TINI_EVENT_ERROR;
+	ev->code = TINI_SYNTAX;
+	// point at the offending byte, or the last mark if the text ended early
+	if (p < pe) { mark = p; }
+	p++;
+	SET(ev->name, TINI_NONE);
+	ev->name.length = 1;
+	// errors are located from the previous one, so reporting many stays linear
+	tini_locate(it->located, &ev->name);
+	ev->name.line += it->line;
+	it->located = ev->name.line_start;
+	it->line = ev->name.line;
+	it->cs = %%{ write error; }%%;
+	return true;
 }
-
@@ -0,0 +1,219 @@
+#include "../include/tini.h"
+
+#include <stdlib.h>
+
+/**
+ * The bytes each patched field held before it was set, restored in reverse
+ * order if a later line fails. A field patched twice is saved twice, so the
+ * first save wins on rollback.
+ */
+struct undo
+{
+	struct save { void *dst; size_t size, off; } *saves;
+	size_t nsaves, savecap;
+	char *bytes;
+	size_t len, cap;
+	char buf[256];
+	struct save savebuf[16];
+};
+
+static int
+undo_save(struct undo *u, void *dst, size_t size)
+{
+	if (u->nsaves == u->savecap) {
+		size_t cap = u->savecap * 2;
+		struct save *saves = u->saves == u->savebuf ?
+			malloc(cap * sizeof(*saves)) :
+			realloc(u->saves, cap * sizeof(*saves));
+		if (saves == NULL) { return -1; }
+		if (u->saves == u->savebuf) {
+			memcpy(saves, u->savebuf, sizeof(u->savebuf));
+		}
+		u->saves = saves;
+		u->savecap = cap;
+	}
+	if (u->len + size > u->cap) {
+		size_t cap = u->cap * 2;
+		while (cap < u->len + size) { cap *= 2; }
+		char *bytes = u->bytes == u->buf ? malloc(cap) : realloc(u->bytes, cap);
+		if (bytes == NULL) { return -1; }
+		if (u->bytes == u->buf) {
+			memcpy(bytes, u->buf, u->len);
+		}
+		u->bytes = bytes;
+		u->cap = cap;
+	}
+	memcpy(u->bytes + u->len, dst, size);
+	u->saves[u->nsaves++] = (struct save){ dst, size, u->len };
+	u->len += size;
+	return 0;
+}
+
+static void
+undo_apply(struct undo *u)
+{
+	while (u->nsaves > 0) {
+		const struct save *s = &u->saves[--u->nsaves];
+		memcpy(s->dst, u->bytes + s->off, s->size);
+	}
+}
+
+static void
+undo_free(struct undo *u)
+{
+	if (u->saves != u->savebuf) { free(u->saves); }
+	if (u->bytes != u->buf) { free(u->bytes); }
+}
+
+static inline bool
+is_ws(char c)
+{
+	return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static struct tini
+node(const char *p, const char *pe, enum tini_type type)
+{
+	while (p < pe && is_ws(*p)) { p++; }
+	while (pe > p && is_ws(pe[-1])) { pe--; }
+	return (struct tini){ .start = p, .length = pe - p, .type = type };
+}
+
+static bool
+same(const struct tini *a, const struct tini *b)
+{
+	return a->length == b->length && memcmp(a->start, b->start, a->length) == 0;
+}
+
+/**
+ * Splits a line of the form `[section:label] key = value`, with the section
+ * and label written as in a header. A line without one is global. Section
+ * names and keys may both contain dots, so only the brackets separate them.
+ */
+static bool
+split(const char *p, const char *pe, struct tini *name, struct tini *label,
+		struct tini *key, struct tini *value)
+{
+	*name = node(p, p, TINI_SECTION);
+	*label = (struct tini){ .type = TINI_NONE };
+	if (*p == '[') {
+		const char *close = memchr(p, ']', pe - p);
+		if (close == NULL) { return false; }
+		const char *colon = memchr(p + 1, ':', close - p - 1);
+		*name = node(p + 1, colon ? colon : close, TINI_SECTION);
+		if (colon) { *label = node(colon + 1, close, TINI_LABEL); }
+		if (name->length == 0 || (colon && label->length == 0)) { return false; }
+		p = close + 1;
+	}
+
+	const char *eq = memchr(p, '=', pe - p);
+	if (eq == NULL) { return false; }
+	*key = node(p, eq, TINI_KEY);
+
+	const char *v = eq + 1;
+	while (v < pe && is_ws(*v)) { v++; }
+	*value = (struct tini){ .start = v, .length = pe - v, .type = TINI_VALUE };
+
+	return key->length > 0;
+}
+
+enum tini_result
+tini_patch(struct tini_ctx *ctx, const char *txt, size_t txtlen, int flags)
+{
+	struct undo u = {
+		.savecap = sizeof(u.savebuf) / sizeof(u.savebuf[0]),
+		.cap = sizeof(u.buf),
+	};
+	u.saves = u.savebuf;
+	u.bytes = u.buf;
+
+	struct tini_section section;
+	struct tini name = { .type = TINI_NONE }, label = name;
+	bool loaded = false;
+	uint32_t line = 0;
+
+	ctx->txt = txt;
+	ctx->txtlen = txtlen;
+	ctx->txtline = 0;
+	ctx->nerr = 0;
+	ctx->cursor = NULL;
+
+	if (flags & TINI_VALIDATE) {
+		enum tini_result rc;
+		const char *bad = tini_validate(txt, txt + txtlen, &rc);
+		if (bad != NULL) {
+			struct tini n = { .start = bad, .length = 1, .type = TINI_NONE };
+			tini_add_error(ctx, &n, NULL, rc);
+			return rc;
+		}
+	}
+
+	const char *p = txt, *end = txt + txtlen;
+	for (; p < end && ctx->nerr == 0; line++) {
+		const char *pe = memchr(p, '\n', end - p);
+		const char *next = pe ? pe + 1 : end;
+		if (pe == NULL) { pe = end; }
+
+		const char *s = p;
+		while (s < pe && is_ws(*s)) { s++; }
+		if (s == pe || *s == '#' || *s == ';') {
+			p = next;
+			continue;
+		}
+
+		struct tini n, l, key, value;
+		if (!split(s, pe, &n, &l, &key, &value)) {
+			struct tini bad = { .start = s, .length = pe - s, .type = TINI_NONE };
+			tini_add_error(ctx, &bad, NULL, TINI_SYNTAX);
+			break;
+		}
+
+		// consecutive lines for the same section load it once
+		if (!loaded || !same(&n, &name) || !same(&l, &label) ||
+				(l.type == TINI_NONE) != (label.type == TINI_NONE)) {
+			section = (struct tini_section){ 0 };
+			enum tini_result rc = ctx->load_section ?
+				ctx->load_section(&section, &n,
+						l.type == TINI_LABEL ? &l : NULL, ctx->udata) :
+				TINI_UNUSED_SECTION;
+			if (rc != TINI_SUCCESS) {
+				tini_add_error(ctx, n.length ? &n : &key, NULL, rc);
+				break;
+			}
+			name = n;
+			label = l;
+			loaded = true;
+		}
+
+		const struct tini_field *f = tini_field_find(&section, key.start, key.length);
+		if (f == NULL || section.target == NULL) {
+			tini_add_error(ctx, &key, NULL, TINI_MISSING_KEY);
+			break;
+		}
+
+		void *dst = (char *)section.target + f->offset;
+		struct tini_origin *origin = section.origins ?
+			&section.origins[f - section.fields] : NULL;
+		if (undo_save(&u, dst, f->size) < 0 ||
+				(origin && undo_save(&u, origin, sizeof(*origin)) < 0)) {
+			tini_add_error(ctx, &key, NULL, TINI_NO_MEMORY);
+			break;
+		}
+
+		enum tini_result rc = tini_set_field(section.target, f, &value);
+		if (rc != TINI_SUCCESS) {
+			tini_add_error(ctx, tini_error_node(&key, &value, rc), NULL, rc);
+			break;
+		}
+		if (origin) {
+			*origin = (struct tini_origin){ line + 1, ctx->file, ctx->layer };
+		}
+		p = next;
+	}
+
+	if (ctx->nerr > 0) {
+		undo_apply(&u);
+	}
+	undo_free(&u);
+	return ctx->nerr ? ctx->err[0].code : TINI_SUCCESS;
+}
@@ -0,0 +1,161 @@
+#include "phash.h"
+
+#include <stdlib.h>
+#include <errno.h>
+
+#define EMPTY UINT32_MAX
+#define SEED_MAX (1u << 20)
+
+static const char *
+entry_name(const void *base, size_t stride, size_t i)
+{
+	return *(const char *const *)((const char *)base + stride*i);
+}
+
+static uint32_t
+table_size(size_t n)
+{
+	uint32_t m = 2;
+	while (m < n + n/4) { m <<= 1; }
+	return m;
+}
+
+int
+tini_phash_build(struct tini_phash *ph,
+		const void *base, size_t stride, size_t n)
+{
+	*ph = (struct tini_phash){ 0 };
+	if (n == 0) { return 0; }
+	if (n >= INT32_MAX) { errno = EINVAL; return -1; }
+
+	uint32_t nb = n;
+	uint32_t m = table_size(n);
+	uint32_t mask = m - 1;
+
+	int32_t *disp = calloc(nb, sizeof(*disp));
+	uint32_t *slots = malloc(m * sizeof(*slots));
+	uint32_t *count = calloc(nb + 1, sizeof(*count));
+	uint32_t *order = malloc(n * sizeof(*order));
+	uint32_t *bucket = malloc(nb * sizeof(*bucket));
+	uint32_t *pos = malloc(n * sizeof(*pos));
+	int rc = -1;
+
+	if (!disp || !slots || !count || !order || !bucket || !pos) {
+		errno = ENOMEM;
+		goto done;
+	}
+
+	for (uint32_t i = 0; i < m; i++) { slots[i] = EMPTY; }
+
+	// group the entries by first-level bucket using a counting sort
+	for (size_t i = 0; i < n; i++) {
+		const char *s = entry_name(base, stride, i);
+		pos[i] = tini_hash(s, strlen(s), 0) % nb;
+		count[pos[i] + 1]++;
+	}
+	for (uint32_t b = 0; b < nb; b++) { count[b + 1] += count[b]; }
+	for (size_t i = 0; i < n; i++) { order[count[pos[i]]++] = i; }
+	for (uint32_t b = nb; b > 0; b--) { count[b] = count[b - 1]; }
+	count[0] = 0;
+
+	// place the largest buckets first while the table is mostly empty
+	uint32_t maxsz = 0, nbucket = 0;
+	for (uint32_t b = 0; b < nb; b++) {
+		uint32_t sz = count[b + 1] - count[b];
+		if (sz > maxsz) { maxsz = sz; }
+	}
+	for (uint32_t sz = maxsz; sz > 0; sz--) {
+		for (uint32_t b = 0; b < nb; b++) {
+			if (count[b + 1] - count[b] == sz) { bucket[nbucket++] = b; }
+		}
+	}
+
+	uint32_t free_slot = 0;
+	for (uint32_t bi = 0; bi < nbucket; bi++) {
+		uint32_t b = bucket[bi];
+		uint32_t *keys = order + count[b];
+		uint32_t sz = count[b + 1] - count[b];
+
+		if (sz == 1) {
+			while (slots[free_slot] != EMPTY) { free_slot++; }
+			slots[free_slot] = keys[0];
+			disp[b] = -(int32_t)free_slot - 1;
+			continue;
+		}
+
+		for (uint32_t i = 0; i < sz; i++) {
+			const char *a = entry_name(base, stride, keys[i]);
+			for (uint32_t j = i + 1; j < sz; j++) {
+				if (strcmp(a, entry_name(base, stride, keys[j])) == 0) {
+					errno = EINVAL;
+					goto done;
+				}
+			}
+		}
+
+		uint32_t d = 1;
+		for (; d < SEED_MAX; d++) {
+			uint32_t i = 0;
+			for (; i < sz; i++) {
+				const char *s = entry_name(base, stride, keys[i]);
+				uint32_t p = tini_hash(s, strlen(s), d) & mask;
+				if (slots[p] != EMPTY) { break; }
+				slots[p] = keys[i];
+				pos[i] = p;
+			}
+			if (i == sz) { break; }
+			while (i > 0) { slots[pos[--i]] = EMPTY; }
+		}
+		if (d == SEED_MAX) {
+			errno = EINVAL;
+			goto done;
+		}
+		disp[b] = d;
+	}
+
+	ph->disp = disp;
+	ph->slots = slots;
+	ph->nbuckets = nb;
+	ph->mask = mask;
+	disp = NULL;
+	slots = NULL;
+	rc = 0;
+
+done:
+	free(disp);
+	free(slots);
+	free(count);
+	free(order);
+	free(bucket);
+	free(pos);
+	return rc;
+}
+
+ssize_t
+tini_phash_find(const struct tini_phash *ph,
+		const void *base, size_t stride,
+		const char *name, size_t namelen)
+{
+	if (ph->nbuckets == 0) { return -1; }
+
+	int32_t d = ph->disp[tini_hash(name, namelen, 0) % ph->nbuckets];
+	if (d == 0) { return -1; }
+
+	uint32_t p = d < 0 ?
+		(uint32_t)(-(d + 1)) :
+		(uint32_t)tini_hash(name, namelen, d) & ph->mask;
+	uint32_t idx = ph->slots[p];
+	if (idx == EMPTY) { return -1; }
+
+	const char *s = entry_name(base, stride, idx);
+	if (strncmp(s, name, namelen) != 0 || s[namelen] != '\0') { return -1; }
+	return idx;
+}
+
+void
+tini_phash_free(struct tini_phash *ph)
+{
+	free(ph->disp);
+	free(ph->slots);
+	*ph = (struct tini_phash){ 0 };
+}
@@ -0,0 +1,45 @@
+#ifndef TINI_PHASH_H
+#define TINI_PHASH_H
+
+#include "../include/tini.h"
+
+/**
+ * Hashes a string slice with a seed. This is FNV-1a with a final avalanche,
+ * which is plenty for the short identifiers used in configuration files.
+ */
+static inline uint64_t
+tini_hash(const char *s, size_t len, uint64_t seed)
+{
+	uint64_t h = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+	for (size_t i = 0; i < len; i++) {
+		h ^= (uint8_t)s[i];
+		h *= 0x100000001b3ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/**
+ * Builds a minimal-probe perfect hash over `n` entries starting at `base`.
+ * Each entry is `stride` bytes and must begin with a `const char *` name.
+ * Returns 0 on success or -1 with `errno` set to `ENOMEM` or `EINVAL` (for
+ * duplicate names).
+ */
+extern int
+tini_phash_build(struct tini_phash *ph,
+		const void *base, size_t stride, size_t n);
+
+/**
+ * Finds the index of the entry named by `name`. Returns -1 if not found.
+ */
+extern ssize_t
+tini_phash_find(const struct tini_phash *ph,
+		const void *base, size_t stride,
+		const char *name, size_t namelen);
+
+extern void
+tini_phash_free(struct tini_phash *ph);
+
+#endif
@@ -0,0 +1,259 @@
+#include "../include/tini.h"
+
+#define LOC "\x1b[1m"
+#define ERR "\x1b[1;31m"
+#define RNG "\x1b[1;32m"
+#define RST "\x1b[0m"
+
+#define ERR_MAX (sizeof(((struct tini_ctx *)0)->err)/sizeof(((struct tini_ctx *)0)->err[0]))
+
+#define SARIF_BEGIN \
+	"{\"version\":\"2.1.0\"," \
+	"\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\"," \
+	"\"runs\":[{\"tool\":{\"driver\":{\"name\":\"tini\"}},\"results\":["
+#define SARIF_END "]}]}\n"
+
+void
+tini_render_put(struct tini_render *r, const char *s, size_t n)
+{
+	if (r->pos < r->len) {
+		size_t avail = r->len - r->pos;
+		memcpy(r->buf + r->pos, s, n < avail ? n : avail);
+	}
+	r->pos += n;
+}
+
+static inline void
+put(struct tini_render *r, const char *s, size_t n)
+{
+	tini_render_put(r, s, n);
+}
+
+#define PUTS(r, lit) put(r, lit, sizeof(lit) - 1)
+
+static void
+put_char(struct tini_render *r, char c, size_t n)
+{
+	for (; n > 0; n--) {
+		if (r->pos < r->len) { r->buf[r->pos] = c; }
+		r->pos++;
+	}
+}
+
+static void
+put_str(struct tini_render *r, const char *s)
+{
+	put(r, s, strlen(s));
+}
+
+static void
+put_uint(struct tini_render *r, uint64_t v)
+{
+	char tmp[20], *p = tmp + sizeof(tmp);
+	do { *--p = '0' + v % 10; } while (v /= 10);
+	put(r, p, tmp + sizeof(tmp) - p);
+}
+
+/**
+ * Writes `s` escaped for a JSON string, without the surrounding quotes.
+ */
+static void
+put_escaped(struct tini_render *r, const char *s, size_t n)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char *p = s, *pe = s + n, *run = s;
+
+	for (; p < pe; p++) {
+		uint8_t c = *p;
+		if (c >= 0x20 && c != '"' && c != '\\') { continue; }
+		put(r, run, p - run);
+		run = p + 1;
+		switch (c) {
+		case '"':  PUTS(r, "\\\""); break;
+		case '\\': PUTS(r, "\\\\"); break;
+		case '\n': PUTS(r, "\\n"); break;
+		case '\r': PUTS(r, "\\r"); break;
+		case '\t': PUTS(r, "\\t"); break;
+		default: {
+			char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+			put(r, esc, sizeof(esc));
+		}
+		}
+	}
+	put(r, run, p - run);
+}
+
+static void
+put_json(struct tini_render *r, const char *s, size_t n)
+{
+	put_char(r, '"', 1);
+	put_escaped(r, s, n);
+	put_char(r, '"', 1);
+}
+
+void
+tini_render_begin(struct tini_render *r, enum tini_format format,
+		char *buf, size_t len)
+{
+	*r = (struct tini_render){ .buf = buf, .len = len, .format = format };
+	if (format == TINI_FORMAT_SARIF) {
+		PUTS(r, SARIF_BEGIN);
+	}
+}
+
+size_t
+tini_render_end(struct tini_render *r)
+{
+	if (r->format == TINI_FORMAT_SARIF) {
+		PUTS(r, SARIF_END);
+	}
+	return r->pos;
+}
+
+static void
+render_caret(struct tini_render *r, const struct tini_ctx *ctx,
+		const struct tini *node, const char *path,
+		const char *msg, const char *arg)
+{
+	bool color = r->format == TINI_FORMAT_COLOR;
+	const char *p = node->line_start;
+	const char *txtend = ctx->txt + ctx->txtlen;
+	// a node from another text, such as an overlay layer, is shown to its end
+	if (p < ctx->txt || p > txtend) {
+		txtend = node->start + node->length;
+	}
+	const char *eol = memchr(p, '\n', txtend - p);
+	if (eol == NULL) { eol = txtend; }
+
+	if (color) { PUTS(r, LOC); }
+	put_str(r, path);
+	put_char(r, ':', 1);
+	put_uint(r, node->line + 1);
+	put_char(r, ':', 1);
+	put_uint(r, node->column + 1);
+	if (color) { PUTS(r, ": " RST ERR "error: " RST); }
+	else { PUTS(r, ": error: "); }
+	put_str(r, msg);
+	if (arg) {
+		PUTS(r, ": ");
+		put_str(r, arg);
+	}
+
+	PUTS(r, "\n    ");
+	put(r, p, eol - p);
+	PUTS(r, "\n    ");
+
+	// tabs are expanded so the caret lines up under the source
+	const char *col = p + node->column;
+	for (const char *run = p; p <= col; p++) {
+		if (p == col || *p == '\t') {
+			put_char(r, ' ', p - run);
+			if (p < col) { put_char(r, ' ', 8); }
+			run = p + 1;
+		}
+	}
+
+	if (color) { PUTS(r, RNG); }
+	put_char(r, '^', 1);
+	if (node->length > 1) { put_char(r, '~', node->length - 1); }
+	if (color) { PUTS(r, RST); }
+	put_char(r, '\n', 1);
+}
+
+static void
+render_json(struct tini_render *r, const struct tini *node, const char *path,
+		enum tini_result code, const char *msg, const char *arg)
+{
+	PUTS(r, "{\"file\":");
+	put_json(r, path, strlen(path));
+	PUTS(r, ",\"line\":");
+	put_uint(r, node->line + 1);
+	PUTS(r, ",\"column\":");
+	put_uint(r, node->column + 1);
+	PUTS(r, ",\"length\":");
+	put_uint(r, node->length);
+	PUTS(r, ",\"code\":");
+	put_uint(r, code);
+	PUTS(r, ",\"message\":");
+	put_json(r, msg, strlen(msg));
+	if (arg) {
+		PUTS(r, ",\"arg\":");
+		put_json(r, arg, strlen(arg));
+	}
+	PUTS(r, "}\n");
+}
+
+static void
+render_sarif(struct tini_render *r, const struct tini *node, const char *path,
+		enum tini_result code, const char *msg, const char *arg)
+{
+	if (r->count > 0) { put_char(r, ',', 1); }
+	PUTS(r, "{\"ruleId\":\"tini/");
+	put_uint(r, code);
+	PUTS(r, "\",\"level\":\"error\",\"message\":{\"text\":");
+	put_char(r, '"', 1);
+	put_escaped(r, msg, strlen(msg));
+	if (arg) {
+		PUTS(r, ": ");
+		put_escaped(r, arg, strlen(arg));
+	}
+	put_char(r, '"', 1);
+	PUTS(r, "},\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":");
+	put_json(r, path, strlen(path));
+	PUTS(r, "},\"region\":{\"startLine\":");
+	put_uint(r, node->line + 1);
+	PUTS(r, ",\"startColumn\":");
+	put_uint(r, node->column + 1);
+	PUTS(r, ",\"charLength\":");
+	put_uint(r, node->length);
+	PUTS(r, "}}}]}");
+}
+
+void
+tini_render_node(struct tini_render *r, const struct tini_ctx *ctx,
+		const struct tini *node, const char *path,
+		enum tini_result code, const char *msg, const char *arg)
+{
+	struct tini located;
+	if (node->line_start == NULL &&
+			node->start >= ctx->txt && node->start <= ctx->txt + ctx->txtlen) {
+		located = *node;
+		tini_locate(ctx->txt, &located);
+		node = &located;
+	}
+	else if (node->line_start == NULL) {
+		located = *node;
+		located.line_start = node->start;
+		node = &located;
+	}
+	if (msg == NULL) {
+		msg = tini_msg(code);
+	}
+
+	switch (r->format) {
+	case TINI_FORMAT_TEXT:
+	case TINI_FORMAT_COLOR:
+		render_caret(r, ctx, node, path, msg, arg);
+		break;
+	case TINI_FORMAT_JSON:
+		render_json(r, node, path, code, msg, arg);
+		break;
+	case TINI_FORMAT_SARIF:
+		render_sarif(r, node, path, code, msg, arg);
+		break;
+	}
+	r->count++;
+}
+
+void
+tini_render_errors(struct tini_render *r, const struct tini_ctx *ctx,
+		const char *path)
+{
+	unsigned nerr = ctx->nerr;
+	if (nerr > ERR_MAX) { nerr = ERR_MAX; }
+
+	for (unsigned i = 0; i < nerr; i++) {
+		const struct tini_error *err = &ctx->err[i];
+		tini_render_node(r, ctx, &err->node, path, err->code, err->msg, err->arg);
+	}
+}
@@ -0,0 +1,98 @@
+#include "../include/tini.h"
+#include "phash.h"
+
+int
+tini_schema_compile(struct tini_schema *s)
+{
+	return tini_phash_build(&s->hash, s->sections,
+			sizeof(*s->sections), s->nsections);
+}
+
+void
+tini_schema_free(struct tini_schema *s)
+{
+	tini_phash_free(&s->hash);
+}
+
+const struct tini_schema_section *
+tini_schema_find(const struct tini_schema *s, const char *name, size_t len)
+{
+	if (s->hash.nbuckets) {
+		ssize_t idx = tini_phash_find(&s->hash, s->sections,
+				sizeof(*s->sections), name, len);
+		return idx < 0 ? NULL : &s->sections[idx];
+	}
+
+	// schemas that were never compiled fall back to a linear scan
+	const struct tini_schema_section *p = s->sections, *pe = p + s->nsections;
+	for (; p < pe; p++) {
+		if (strncmp(p->name, name, len) == 0 && p->name[len] == '\0') {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+struct route
+{
+	const struct tini_schema *schema;
+	char *target;
+};
+
+static enum tini_result
+load_route(struct tini_section *section,
+		const struct tini *name,
+		const struct tini *label,
+		void *udata)
+{
+	(void)label;
+
+	const struct route *r = udata;
+	const struct tini_schema_section *s =
+		tini_schema_find(r->schema, name->start, name->length);
+	if (s == NULL) {
+		return TINI_MISSING_SECTION;
+	}
+	section->fields = s->fields;
+	section->nfields = s->nfields;
+	section->target = r->target + s->offset;
+	section->defaults = s->defaults;
+	section->size = s->size;
+	return TINI_SUCCESS;
+}
+
+static enum tini_result
+route(struct tini_ctx *ctx,
+		const struct tini_schema *schema, void *target,
+		const char *txt, size_t txtlen,
+		int flags,
+		enum tini_result (*apply)(struct tini_ctx *, const char *, size_t, int))
+{
+	struct route r = { schema, target };
+	struct tini_ctx saved = *ctx;
+
+	ctx->load_section = load_route;
+	ctx->udata = &r;
+	enum tini_result rc = apply(ctx, txt, txtlen, flags);
+	ctx->load_section = saved.load_section;
+	ctx->udata = saved.udata;
+	return rc;
+}
+
+enum tini_result
+tini_parse_into(struct tini_ctx *ctx,
+		const struct tini_schema *schema, void *target,
+		const char *txt, size_t txtlen,
+		int flags)
+{
+	return route(ctx, schema, target, txt, txtlen, flags, tini_parse);
+}
+
+enum tini_result
+tini_patch_into(struct tini_ctx *ctx,
+		const struct tini_schema *schema, void *target,
+		const char *txt, size_t txtlen,
+		int flags)
+{
+	return route(ctx, schema, target, txt, txtlen, flags, tini_patch);
+}
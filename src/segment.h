@@ -0,0 +1,37 @@
+#ifndef TINI_SEGMENT_H
+#define TINI_SEGMENT_H
+
+#include "../include/tini.h"
+
+/**
+ * Returns the length of the terminator named by a heredoc opening such as
+ * `<<EOF`, or 0 if [p, pe) is not one. The opening must make up the whole
+ * first line of the value.
+ */
+static inline size_t
+tini_heredoc_tag(const char *p, const char *pe)
+{
+	if (pe - p < 3 || p[0] != '<' || p[1] != '<') { return 0; }
+	for (const char *c = p + 2; c < pe; c++) {
+		if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+				(*c >= '0' && *c <= '9') || *c == '_' || *c == '-')) {
+			return 0;
+		}
+	}
+	return pe - p - 2;
+}
+
+/**
+ * Returns the length of the backslash that continues the line [p, pe) onto
+ * the next one, counting the carriage return of a CRLF line ending after it,
+ * or 0 if the line does not end in one.
+ */
+static inline size_t
+tini_continuation(const char *p, const char *pe)
+{
+	if (pe > p && pe[-1] == '\\') { return 1; }
+	if (pe - p > 1 && pe[-1] == '\r' && pe[-2] == '\\') { return 2; }
+	return 0;
+}
+
+#endif
@@ -20,6 +20,33 @@ tini_field_find(const struct tini_section *s,
 	return NULL;
 }
 
+static enum tini_result
+assign_field(const struct tini_section *section,
+		const struct tini_field *f,
+		const struct tini *value)
+{
+	if (f == NULL) {
+		return TINI_MISSING_KEY;
+	}
+
+	bool dup = false;
+	if (section->seen) {
+		size_t idx = f - section->fields;
+		uint64_t bit = UINT64_C(1) << (idx & 63);
+		dup = section->seen[idx >> 6] & bit;
+		section->seen[idx >> 6] |= bit;
+	}
+
+	enum tini_result rc = tini_set_field(section->target, f, value);
+	if (rc == TINI_SUCCESS && section->origins) {
+		section->origins[f - section->fields] = section->origin;
+	}
+	if (rc == TINI_SUCCESS && dup) {
+		rc = TINI_DUPLICATE_KEY;
+	}
+	return rc;
+}
+
 enum tini_result
 tini_assign(const struct tini_section *section,
 		const struct tini *key,
@@ -28,11 +55,40 @@ tini_assign(const struct tini_section *section,
 {
 	(void)udata;
 
-	const struct tini_field *f = tini_field_find(section, key->start, key->length);
-	if (f == NULL) {
-		return TINI_MISSING_KEY;
+	return assign_field(section,
+			tini_field_find(section, key->start, key->length),
+			value);
+}
+
+size_t
+tini_assign_batch(const struct tini_section *section,
+		struct tini_pair *pairs,
+		size_t n,
+		void *udata)
+{
+	(void)udata;
+
+	// keys usually follow the field declaration order, so each search resumes
+	// after the previous match and the batch resolves in a single sweep
+	const struct tini_field *fields = section->fields;
+	size_t nfields = section->nfields, cursor = 0, nfail = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		const struct tini *key = &pairs[i].key;
+		const struct tini_field *f = NULL;
+		for (size_t j = 0; j < nfields; j++) {
+			size_t idx = cursor + j;
+			if (idx >= nfields) { idx -= nfields; }
+			if (streq(fields[idx].name, key->start, key->length)) {
+				f = &fields[idx];
+				cursor = idx + 1;
+				break;
+			}
+		}
+		pairs[i].rc = assign_field(section, f, &pairs[i].value);
+		nfail += pairs[i].rc != TINI_SUCCESS;
 	}
-	return tini_set_field(section->target, f, value);
+	return nfail;
 }
 
 #define SETS(rc, out, type, val, min, max) do { \
@@ -98,6 +154,64 @@ set_number(void *out, size_t len, const struct tini *value)
 	return rc;
 }
 
+static enum tini_result
+set_size(void *out, size_t len, const struct tini *value)
+{
+	uint64_t val;
+	enum tini_result rc = tini_size(&val, value);
+	if (rc == TINI_SUCCESS) {
+		switch (len) {
+		case sizeof(uint32_t):
+			if (val > UINT32_MAX) { rc = TINI_SIZE_TOO_BIG; }
+			else { *(uint32_t *)out = (uint32_t)val; }
+			break;
+		case sizeof(uint64_t): *(uint64_t *)out = val; break;
+		default: rc = TINI_INVALID_TYPE; break;
+		}
+	}
+	return rc;
+}
+
+static enum tini_result
+set_ns(void *out, size_t len, enum tini_result (*fn)(int64_t *, const struct tini *),
+		const struct tini *value)
+{
+	if (len != sizeof(int64_t)) {
+		return TINI_INVALID_TYPE;
+	}
+	return fn(out, value);
+}
+
+static enum tini_result
+enum_value(int64_t *val, const struct tini_field *field, const struct tini *value)
+{
+	if (field->enums == NULL) {
+		return TINI_INVALID_TYPE;
+	}
+	return field->type == TINI_FLAGS ?
+		tini_flags_parse(val, field->enums, value) :
+		tini_enum_parse(val, field->enums, value);
+}
+
+/**
+ * Stores a table value in an enum or flag field. Table values may be
+ * negative, such as -1 for "auto", so a value fits if the field holds it
+ * either as a signed or as an unsigned integer.
+ */
+static enum tini_result
+enum_store(void *out, size_t size, int64_t val)
+{
+	enum tini_result rc = TINI_SUCCESS;
+	switch (size) {
+	case sizeof(uint8_t):  SETS(rc, out, uint8_t, val, INT8_MIN, UINT8_MAX); break;
+	case sizeof(uint16_t): SETS(rc, out, uint16_t, val, INT16_MIN, UINT16_MAX); break;
+	case sizeof(uint32_t): SETS(rc, out, uint32_t, val, INT32_MIN, UINT32_MAX); break;
+	case sizeof(uint64_t): *(int64_t *)out = val; break;
+	default: rc = TINI_INVALID_TYPE; break;
+	}
+	return rc;
+}
+
 enum tini_result
 tini_set(void *t, size_t size, enum tini_type type,
 		const struct tini *value)
@@ -109,10 +223,169 @@ tini_set(void *t, size_t size, enum tini_type type,
 	case TINI_UNSIGNED: return set_unsigned(t, size, value);
 	case TINI_NUMBER:   return set_number(t, size, value);
 	case TINI_NODE:     return (memcpy(t, value, sizeof(*value)), 0);
+	case TINI_DURATION: return set_ns(t, size, tini_duration, value);
+	case TINI_SIZE:     return set_size(t, size, value);
+	case TINI_TIME:     return set_ns(t, size, tini_time, value);
 	default:            return TINI_INVALID_TYPE;
 	}
 }
 
+void
+tini_check_charset(struct tini_check *check, const char *spec)
+{
+	const uint8_t *p = (const uint8_t *)spec;
+	for (; *p; p++) {
+		unsigned lo = *p, hi = *p;
+		if (p[1] == '-' && p[2]) {
+			hi = p[2];
+			p += 2;
+		}
+		for (unsigned c = lo; c <= hi; c++) {
+			check->charset[c >> 6] |= UINT64_C(1) << (c & 63);
+		}
+	}
+	check->mask |= TINI_CHECK_CHARSET;
+}
+
+/**
+ * Checks a value as the text it joins to, so the lines of a multiline value
+ * are checked without the heredoc markers, backslashes and indentation that
+ * join them.
+ */
+static enum tini_result
+check_text(const struct tini_check *c, const struct tini *value)
+{
+	size_t len = tini_length(value);
+	if ((c->mask & TINI_CHECK_LENGTH) && len < c->minlen) {
+		return TINI_LENGTH_TOO_SHORT;
+	}
+	if ((c->mask & TINI_CHECK_LENGTH) && len > c->maxlen) {
+		return TINI_LENGTH_TOO_LONG;
+	}
+
+	size_t n = c->prefix ? strlen(c->prefix) : 0, off = 0;
+	if (n > len) {
+		return TINI_VALUE_PATTERN;
+	}
+	if (n == 0 && !(c->mask & TINI_CHECK_CHARSET)) {
+		return TINI_SUCCESS;
+	}
+
+	const char *cursor = NULL;
+	struct tini seg;
+	while (tini_segment(value, &cursor, &seg)) {
+		if (off < n) {
+			size_t k = n - off < seg.length ? n - off : seg.length;
+			if (memcmp(seg.start, c->prefix + off, k) != 0) {
+				return TINI_VALUE_PATTERN;
+			}
+		}
+		off += seg.length;
+		if (c->mask & TINI_CHECK_CHARSET) {
+			const uint8_t *p = (const uint8_t *)seg.start, *pe = p + seg.length;
+			for (; p < pe; p++) {
+				if (!(c->charset[*p >> 6] & (UINT64_C(1) << (*p & 63)))) {
+					return TINI_VALUE_PATTERN;
+				}
+			}
+		}
+	}
+	return TINI_SUCCESS;
+}
+
+#define RANGE(c, v, m) \
+	((v) < (c)->min.m ? TINI_VALUE_TOO_SMALL : \
+	 (v) > (c)->max.m ? TINI_VALUE_TOO_BIG : TINI_SUCCESS)
+
+static enum tini_result
+check_range(const struct tini_check *c, enum tini_type type, size_t size,
+		const void *v)
+{
+	switch (type) {
+	case TINI_SIGNED:
+	case TINI_DURATION:
+	case TINI_TIME:
+		switch (size) {
+		case sizeof(int8_t):  return RANGE(c, *(const int8_t *)v, i);
+		case sizeof(int16_t): return RANGE(c, *(const int16_t *)v, i);
+		case sizeof(int32_t): return RANGE(c, *(const int32_t *)v, i);
+		case sizeof(int64_t): return RANGE(c, *(const int64_t *)v, i);
+		}
+		break;
+	case TINI_UNSIGNED:
+	case TINI_SIZE:
+		switch (size) {
+		case sizeof(uint8_t):  return RANGE(c, *(const uint8_t *)v, u);
+		case sizeof(uint16_t): return RANGE(c, *(const uint16_t *)v, u);
+		case sizeof(uint32_t): return RANGE(c, *(const uint32_t *)v, u);
+		case sizeof(uint64_t): return RANGE(c, *(const uint64_t *)v, u);
+		}
+		break;
+	case TINI_NUMBER:
+		switch (size) {
+		case sizeof(float):  return RANGE(c, *(const float *)v, d);
+		case sizeof(double): return RANGE(c, *(const double *)v, d);
+		}
+		break;
+	default:
+		break;
+	}
+	return TINI_INVALID_TYPE;
+}
+
+static enum tini_result
+set_unchecked(void *t, const struct tini_field *field, const struct tini *value)
+{
+	int64_t val;
+	enum tini_result rc;
+
+	switch (field->type) {
+	case TINI_ENUM:
+	case TINI_FLAGS:
+		rc = enum_value(&val, field, value);
+		return rc == TINI_SUCCESS ? enum_store(t, field->size, val) : rc;
+	default:
+		return tini_set(t, field->size, field->type, value);
+	}
+}
+
+/**
+ * Sets a field with constraints. Numeric values are converted into a
+ * scratch value first so the target is left untouched on a violation.
+ */
+static enum tini_result
+set_checked(void *t, const struct tini_field *field, const struct tini *value)
+{
+	const struct tini_check *c = field->check;
+	enum tini_result rc = check_text(c, value);
+	if (rc != TINI_SUCCESS) {
+		return rc;
+	}
+	if (!(c->mask & TINI_CHECK_RANGE)) {
+		return set_unchecked(t, field, value);
+	}
+	if (field->type == TINI_ENUM || field->type == TINI_FLAGS) {
+		// the table value is checked as signed, before it is stored
+		int64_t val;
+		rc = enum_value(&val, field, value);
+		if (rc == TINI_SUCCESS) { rc = RANGE(c, val, i); }
+		return rc == TINI_SUCCESS ? enum_store(t, field->size, val) : rc;
+	}
+
+	union { int64_t i; double d; } tmp;
+	if (field->size > sizeof(tmp)) {
+		return TINI_INVALID_TYPE;
+	}
+	rc = set_unchecked(&tmp, field, value);
+	if (rc == TINI_SUCCESS) {
+		rc = check_range(c, field->type, field->size, &tmp);
+	}
+	if (rc == TINI_SUCCESS) {
+		memcpy(t, &tmp, field->size);
+	}
+	return rc;
+}
+
 enum tini_result
 tini_set_field(void *target,
 		const struct tini_field *field,
@@ -122,6 +395,9 @@ tini_set_field(void *target,
 		return TINI_UNUSED_KEY;
 	}
 	void *t = (char *)target + field->offset;
-	return tini_set(t, field->size, field->type, value);
+	if (field->check) {
+		return set_checked(t, field, value);
+	}
+	return set_unchecked(t, field, value);
 }
 
@@ -0,0 +1,238 @@
+#include "../include/tini.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#define MAGIC 0x494e4954u // "TINI"
+#define VERSION 1
+#define SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+
+/**
+ * Each published region starts with this header, followed by the payload at
+ * `TINI_SHM_ALIGN` bytes.
+ */
+struct header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t generation;
+	uint64_t size;
+};
+
+_Static_assert(sizeof(struct header) <= TINI_SHM_ALIGN, "header too large");
+
+int
+tini_shm_init(struct tini_shm *shm)
+{
+	void *ctl = mmap(NULL, sizeof(*shm->ctl), PROT_READ|PROT_WRITE,
+			MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+	if (ctl == MAP_FAILED) {
+		return -1;
+	}
+	*shm = (struct tini_shm){ .ctl = ctl, .fd = -1 };
+	if (socketpair(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0, shm->sock) < 0) {
+		int err = errno;
+		munmap(ctl, sizeof(*shm->ctl));
+		*shm = (struct tini_shm){ .fd = -1, .sock = { -1, -1 } };
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+void
+tini_shm_free(struct tini_shm *shm)
+{
+	if (shm->fd >= 0) { close(shm->fd); }
+	if (shm->sock[0] >= 0) { close(shm->sock[0]); }
+	if (shm->sock[1] >= 0) { close(shm->sock[1]); }
+	if (shm->ctl) { munmap(shm->ctl, sizeof(*shm->ctl)); }
+	*shm = (struct tini_shm){ .fd = -1, .sock = { -1, -1 } };
+}
+
+static int
+write_all(int fd, const void *buf, size_t len, off_t off)
+{
+	const char *p = buf;
+	while (len > 0) {
+		ssize_t n = pwrite(fd, p, len, off);
+		if (n < 0) {
+			if (errno == EINTR) { continue; }
+			return -1;
+		}
+		p += n;
+		len -= n;
+		off += n;
+	}
+	return 0;
+}
+
+/**
+ * Receives the descriptor queued on the socketpair. With `MSG_PEEK` the
+ * message stays queued and the caller gets its own duplicate.
+ */
+static int
+recv_region(const struct tini_shm *shm, int flags)
+{
+	char data;
+	union { struct cmsghdr hdr; char buf[CMSG_SPACE(sizeof(int))]; } cbuf;
+	struct iovec iov = { &data, sizeof(data) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf.buf,
+		.msg_controllen = sizeof(cbuf.buf),
+	};
+
+	ssize_t n;
+	do {
+		n = recvmsg(shm->sock[1], &msg, flags|MSG_DONTWAIT|MSG_CMSG_CLOEXEC);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0) {
+		return -1;
+	}
+
+	struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+	if (c == NULL || c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) {
+		errno = EBADMSG;
+		return -1;
+	}
+	int fd;
+	memcpy(&fd, CMSG_DATA(c), sizeof(fd));
+	return fd;
+}
+
+static int
+send_region(const struct tini_shm *shm, int fd)
+{
+	char data = 0;
+	union { struct cmsghdr hdr; char buf[CMSG_SPACE(sizeof(int))]; } cbuf = { 0 };
+	struct iovec iov = { &data, sizeof(data) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf.buf,
+		.msg_controllen = sizeof(cbuf.buf),
+	};
+
+	struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+	c->cmsg_level = SOL_SOCKET;
+	c->cmsg_type = SCM_RIGHTS;
+	c->cmsg_len = CMSG_LEN(sizeof(fd));
+	memcpy(CMSG_DATA(c), &fd, sizeof(fd));
+
+	ssize_t n;
+	do {
+		n = sendmsg(shm->sock[0], &msg, MSG_DONTWAIT);
+	} while (n < 0 && errno == EINTR);
+	return n < 0 ? -1 : 0;
+}
+
+int
+tini_shm_publish(struct tini_shm *shm, const void *data, size_t size)
+{
+	uint64_t gen = __atomic_load_n(&shm->ctl->generation, __ATOMIC_RELAXED) + 1;
+	struct header h = { MAGIC, VERSION, gen, size };
+
+	int fd = memfd_create("tini", MFD_CLOEXEC|MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		return -1;
+	}
+	if (ftruncate(fd, TINI_SHM_ALIGN + size) < 0 ||
+			write_all(fd, &h, sizeof(h), 0) < 0 ||
+			write_all(fd, data, size, TINI_SHM_ALIGN) < 0 ||
+			fcntl(fd, F_ADD_SEALS, SEALS) < 0 ||
+			send_region(shm, fd) < 0) {
+		int err = errno;
+		close(fd);
+		errno = err;
+		return -1;
+	}
+
+	// the new region is queued behind the previous one, which is dropped so
+	// that workers peeking at the head of the queue only ever see the latest
+	if (shm->fd >= 0) {
+		int old = recv_region(shm, 0);
+		if (old >= 0) { close(old); }
+		close(shm->fd);
+	}
+	shm->fd = fd;
+
+	__atomic_store_n(&shm->ctl->generation, gen, __ATOMIC_RELEASE);
+	return 0;
+}
+
+int
+tini_shm_attach(const struct tini_shm *shm, struct tini_shm_view *view)
+{
+	uint64_t gen = tini_shm_generation(shm);
+	if (gen == 0) {
+		errno = ENOENT;
+		return -1;
+	}
+	if (gen == view->generation) {
+		return 0;
+	}
+
+	int fd = recv_region(shm, MSG_PEEK);
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct stat st;
+	void *map = MAP_FAILED;
+	int rc = -1;
+	if (fstat(fd, &st) < 0) {
+		goto out;
+	}
+	// only a region that can never change again is trusted
+	int seals = fcntl(fd, F_GET_SEALS);
+	if (seals < 0 || (seals & SEALS) != SEALS || (size_t)st.st_size < TINI_SHM_ALIGN) {
+		errno = EBADMSG;
+		goto out;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		goto out;
+	}
+
+	const struct header *h = map;
+	if (h->magic != MAGIC || h->version != VERSION ||
+			h->size > (size_t)st.st_size - TINI_SHM_ALIGN) {
+		munmap(map, st.st_size);
+		errno = EBADMSG;
+		goto out;
+	}
+	// the queue may already hold a region newer than the generation read
+	if (h->generation == view->generation) {
+		munmap(map, st.st_size);
+		rc = 0;
+		goto out;
+	}
+
+	tini_shm_detach(view);
+	view->map = map;
+	view->maplen = st.st_size;
+	view->data = (const char *)map + TINI_SHM_ALIGN;
+	view->size = h->size;
+	view->generation = h->generation;
+	rc = 1;
+
+out:
+	close(fd);
+	return rc;
+}
+
+void
+tini_shm_detach(struct tini_shm_view *view)
+{
+	if (view->map) {
+		munmap(view->map, view->maplen);
+	}
+	*view = (struct tini_shm_view){ 0 };
+}
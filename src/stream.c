@@ -0,0 +1,473 @@
+#include "../include/tini.h"
+#include "segment.h"
+#include "bind.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef TINI_ZLIB
+# include <zlib.h>
+#endif
+
+#define INPUT_SIZE 65536
+
+enum format
+{
+	PLAIN,
+	GZIP,
+};
+
+struct tini_stream
+{
+	int fd;
+	enum format format;
+	bool eof;
+	char *buf;
+	size_t cap;
+	size_t len;
+	size_t fed;
+	// buffers bound by tini_stream_parse, kept until the stream is closed
+	char **kept;
+	size_t nkept;
+	size_t keptcap;
+#ifdef TINI_ZLIB
+	z_stream z;
+	unsigned char *in;
+	bool in_eof;
+	bool done;
+#endif
+};
+
+static ssize_t
+read_some(int fd, void *buf, size_t len)
+{
+	for (;;) {
+		ssize_t n = read(fd, buf, len);
+		if (n >= 0 || errno != EINTR) {
+			return n;
+		}
+	}
+}
+
+#ifdef TINI_ZLIB
+static int
+gzip_init(struct tini_stream *s, const char *head, size_t len)
+{
+	s->in = malloc(INPUT_SIZE);
+	if (s->in == NULL) {
+		return -1;
+	}
+	// 16 accepts only a gzip wrapper, matching the magic that selected it
+	if (inflateInit2(&s->z, 15 + 16) != Z_OK) {
+		free(s->in);
+		errno = ENOMEM;
+		return -1;
+	}
+	memcpy(s->in, head, len);
+	s->z.next_in = s->in;
+	s->z.avail_in = len;
+	s->format = GZIP;
+	return 0;
+}
+
+static int
+gzip_input(struct tini_stream *s)
+{
+	if (s->z.avail_in == 0 && !s->in_eof) {
+		ssize_t n = read_some(s->fd, s->in, INPUT_SIZE);
+		if (n < 0) { return -1; }
+		s->in_eof = n == 0;
+		s->z.next_in = s->in;
+		s->z.avail_in = n;
+	}
+	return 0;
+}
+
+/**
+ * Inflates into `out`, returning the number of bytes produced or 0 once the
+ * last member has ended. Concatenated gzip members are read as one stream.
+ */
+static ssize_t
+gzip_read(struct tini_stream *s, char *out, size_t len)
+{
+	if (s->done) { return 0; }
+	s->z.next_out = (unsigned char *)out;
+	s->z.avail_out = len;
+
+	while (s->z.avail_out == len) {
+		if (gzip_input(s) < 0) { return -1; }
+		if (s->z.avail_in == 0) {
+			// input ended inside a member
+			errno = EBADMSG;
+			return -1;
+		}
+
+		int rc = inflate(&s->z, Z_NO_FLUSH);
+		if (rc == Z_STREAM_END) {
+			if (gzip_input(s) < 0) { return -1; }
+			if (s->z.avail_in == 0) {
+				s->done = true;
+				break;
+			}
+			inflateReset(&s->z);
+		}
+		else if (rc != Z_OK) {
+			errno = rc == Z_MEM_ERROR ? ENOMEM : EBADMSG;
+			return -1;
+		}
+	}
+	return len - s->z.avail_out;
+}
+#endif
+
+static bool
+is_gzip(const char *head)
+{
+	return (uint8_t)head[0] == 0x1f && (uint8_t)head[1] == 0x8b;
+}
+
+struct tini_stream *
+tini_stream_open(int fd, size_t window)
+{
+	char head[4];
+	size_t n = 0;
+	while (n < sizeof(head)) {
+		ssize_t r = read_some(fd, head + n, sizeof(head) - n);
+		if (r < 0) { return NULL; }
+		if (r == 0) { break; }
+		n += r;
+	}
+
+	struct tini_stream *s = calloc(1, sizeof(*s));
+	if (s == NULL) { return NULL; }
+	s->fd = fd;
+	s->cap = window > sizeof(head) ? window : sizeof(head);
+	s->buf = malloc(s->cap);
+	if (s->buf == NULL) {
+		free(s);
+		return NULL;
+	}
+
+	int rc = 0;
+	// a raw zlib header is not sniffed: its check only needs the first two
+	// bytes to be a multiple of 31, which plain text like "HK" also meets
+	if (n >= 2 && is_gzip(head)) {
+#ifdef TINI_ZLIB
+		rc = gzip_init(s, head, n);
+#else
+		errno = EPROTONOSUPPORT;
+		rc = -1;
+#endif
+	}
+	else {
+		memcpy(s->buf, head, n);
+		s->len = n;
+		s->eof = n < sizeof(head);
+	}
+
+	if (rc < 0) {
+		int err = errno;
+		free(s->buf);
+		free(s);
+		errno = err;
+		return NULL;
+	}
+	return s;
+}
+
+static ssize_t
+fill(struct tini_stream *s)
+{
+#ifdef TINI_ZLIB
+	if (s->format == GZIP) {
+		return gzip_read(s, s->buf + s->len, s->cap - s->len);
+	}
+#endif
+	return read_some(s->fd, s->buf + s->len, s->cap - s->len);
+}
+
+/**
+ * Fills the buffer after the text already in it and returns the window up to
+ * its last newline.
+ */
+static ssize_t
+read_window(struct tini_stream *s, const char **txt)
+{
+	for (;;) {
+		while (!s->eof && s->len < s->cap) {
+			ssize_t n = fill(s);
+			if (n < 0) { return -1; }
+			s->eof = n == 0;
+			s->len += n;
+		}
+
+		const char *end = s->len > 0 ? memrchr(s->buf, '\n', s->len) : NULL;
+		if (end || s->eof) {
+			s->fed = end && !s->eof ? (size_t)(end - s->buf) + 1 : s->len;
+			*txt = s->buf;
+			return s->fed;
+		}
+
+		// only a line longer than the window grows it
+		char *buf = realloc(s->buf, s->cap * 2);
+		if (buf == NULL) { return -1; }
+		s->buf = buf;
+		s->cap *= 2;
+	}
+}
+
+ssize_t
+tini_stream_next(struct tini_stream *s, const char **txt)
+{
+	// the partial line after the last window moves to the front
+	s->len -= s->fed;
+	memmove(s->buf, s->buf + s->fed, s->len);
+	s->fed = 0;
+	return read_window(s, txt);
+}
+
+/**
+ * Keeps the current buffer for the nodes bound from it, and starts a new one
+ * with the text from `from` on so the next window continues it.
+ */
+static int
+keep_window(struct tini_stream *s, size_t from)
+{
+	if (s->nkept == s->keptcap) {
+		size_t cap = s->keptcap ? s->keptcap * 2 : 16;
+		char **kept = realloc(s->kept, cap * sizeof(*kept));
+		if (kept == NULL) { return -1; }
+		s->kept = kept;
+		s->keptcap = cap;
+	}
+
+	// a carried value that fills most of the buffer grows it, so the next
+	// window always reads new text
+	size_t len = s->len - from, cap = s->cap;
+	while (len * 2 > cap) { cap *= 2; }
+	char *buf = malloc(cap);
+	if (buf == NULL) { return -1; }
+	memcpy(buf, s->buf + from, len);
+
+	s->kept[s->nkept++] = s->buf;
+	s->buf = buf;
+	s->cap = cap;
+	s->len = len;
+	s->fed = 0;
+	return 0;
+}
+
+/**
+ * Events for `tini_bind_events` from the windows of a stream. A window
+ * boundary may cut a multiline value short, so with `TINI_MULTILINE` a value
+ * that reaches the end of its window is read again with the next one. An
+ * event is held in `ev` while the text before it is validated.
+ */
+struct feed
+{
+	struct tini_stream *s;
+	struct tini_iter it;
+	struct tini_source src;
+	struct tini_source first;
+	struct tini_event ev;
+	const char *end;
+	const char *checked;
+	const char *carry;
+	int flags;
+	int err;
+	bool pending;
+	bool opened;
+	bool failed;
+};
+
+static uint32_t
+count_lines(const char *p, const char *pe)
+{
+	uint32_t n = 0;
+	while ((p = memchr(p, '\n', pe - p)) != NULL) {
+		n++;
+		p++;
+	}
+	return n;
+}
+
+static int
+feed_window(struct feed *f)
+{
+	struct tini_stream *s = f->s;
+	const char *txt;
+	ssize_t n;
+
+	if (f->src.txt == NULL) {
+		n = tini_stream_next(s, &txt);
+	}
+	else {
+		size_t from = f->carry - s->buf;
+		f->src.line += count_lines(s->buf, f->carry);
+		if (keep_window(s, from) < 0) { return -1; }
+		n = read_window(s, &txt);
+	}
+	if (n <= 0) { return n; }
+
+	f->src.txt = txt;
+	f->src.txtlen = n;
+	if (f->first.txt == NULL) { f->first = f->src; }
+	tini_iter_init(&f->it, txt, n);
+	f->it.flags = f->flags;
+	f->checked = txt;
+	f->carry = NULL;
+	return 1;
+}
+
+/**
+ * Checks if the window may have cut the event short: a value that runs to
+ * the end of the window may continue in the next one, and a heredoc may be
+ * terminated there.
+ */
+static bool
+feed_cut(const struct feed *f, const struct tini_event *ev)
+{
+	if (!(f->flags & TINI_MULTILINE) || f->s->eof) { return false; }
+	if (ev->type == TINI_EVENT_VALUE) { return f->it.p == f->it.pe; }
+	if (ev->type != TINI_EVENT_ERROR || ev->code != TINI_SYNTAX) { return false; }
+
+	// an unterminated heredoc is reported at its opening, after the key
+	const char *p = ev->name.start, *pe = f->it.pe;
+	if (p == f->src.txt || p[-1] == '\n') { return false; }
+	const char *eol = memchr(p, '\n', pe - p);
+	return tini_heredoc_tag(p, eol ? eol : pe) > 0;
+}
+
+static bool
+feed_validate(struct feed *f, struct tini_event *ev)
+{
+	enum tini_result rc;
+	const char *p = f->checked < f->end ?
+		tini_validate(f->checked, f->end, &rc) : NULL;
+	if (p == NULL) {
+		if (f->checked < f->end) { f->checked = f->end; }
+		return false;
+	}
+	*ev = (struct tini_event){
+		.type = TINI_EVENT_ERROR,
+		.code = rc,
+		.name = { .start = p, .length = 1, .type = TINI_NONE },
+	};
+	// report a broken sequence once rather than once per byte
+	for (p++; rc == TINI_INVALID_UTF8 && p < f->end && (*p & 0xc0) == 0x80; p++) {}
+	f->checked = p;
+	return true;
+}
+
+static bool
+feed_event(struct tini_event *ev, struct tini_source *src, void *udata)
+{
+	struct feed *f = udata;
+
+	for (;;) {
+		*src = f->src;
+		if (f->pending) {
+			if ((f->flags & TINI_VALIDATE) && feed_validate(f, ev)) {
+				return true;
+			}
+			if (f->ev.type == TINI_EVENT_VALUE && !f->opened) {
+				// keys before the first header belong to the global section
+				*src = f->first;
+				*ev = (struct tini_event){
+					.type = TINI_EVENT_SECTION,
+					.name = { .start = src->txt, .type = TINI_SECTION,
+						.line_start = src->txt },
+				};
+				f->opened = true;
+				return true;
+			}
+			f->pending = false;
+			*ev = f->ev;
+			if (ev->type == TINI_EVENT_NONE) {
+				continue;
+			}
+			if (ev->type == TINI_EVENT_SECTION) {
+				f->opened = true;
+			}
+			else if (ev->type == TINI_EVENT_ERROR) {
+				if (f->flags & TINI_RECOVER) {
+					// the broken line is not validated
+					tini_iter_recover(&f->it);
+					f->checked = f->it.p;
+				}
+				else {
+					f->failed = true;
+				}
+			}
+			return true;
+		}
+		if (f->failed) {
+			return false;
+		}
+
+		if (f->carry == NULL && f->src.txt != NULL && tini_next(&f->it, &f->ev)) {
+			if (f->ev.type == TINI_EVENT_ERROR) {
+				// the iterator locates errors within the window
+				f->ev.name.line += f->src.line;
+			}
+			if (feed_cut(f, &f->ev)) {
+				// the text before the cut line is still validated
+				const char *p = f->ev.name.start;
+				while (p > f->src.txt && p[-1] != '\n') { p--; }
+				f->carry = p;
+				f->ev.type = TINI_EVENT_NONE;
+			}
+			f->end = f->ev.type == TINI_EVENT_ERROR ? f->ev.name.start :
+				f->carry ? f->carry : f->it.p;
+			f->pending = true;
+			continue;
+		}
+
+		if (f->src.txt != NULL && f->carry == NULL) {
+			// the end of the window is validated before moving on
+			f->carry = f->it.pe;
+			f->ev.type = TINI_EVENT_NONE;
+			f->end = f->carry;
+			f->pending = true;
+			continue;
+		}
+
+		int rc = feed_window(f);
+		if (rc <= 0) {
+			f->err = rc < 0 ? errno : 0;
+			return false;
+		}
+	}
+}
+
+int
+tini_stream_parse(struct tini_stream *s, struct tini_ctx *ctx, int flags,
+		enum tini_result *rc)
+{
+	struct feed f = { .s = s, .flags = flags };
+	*rc = tini_bind_events(ctx, flags, feed_event, &f);
+	if (f.err != 0) {
+		errno = f.err;
+		return -1;
+	}
+	return 0;
+}
+
+void
+tini_stream_close(struct tini_stream *s)
+{
+	if (s == NULL) { return; }
+#ifdef TINI_ZLIB
+	if (s->format == GZIP) {
+		inflateEnd(&s->z);
+		free(s->in);
+	}
+#endif
+	for (size_t i = 0; i < s->nkept; i++) {
+		free(s->kept[i]);
+	}
+	free(s->kept);
+	free(s->buf);
+	free(s);
+}
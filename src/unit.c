@@ -0,0 +1,328 @@
+#include "../include/tini.h"
+
+#define NS_PER_US 1000LL
+#define NS_PER_MS (1000LL * NS_PER_US)
+#define NS_PER_S  (1000LL * NS_PER_MS)
+#define NS_PER_M  (60LL * NS_PER_S)
+#define NS_PER_H  (60LL * NS_PER_M)
+#define NS_PER_D  (24LL * NS_PER_H)
+
+#define FRAC_DIGITS_MAX 18
+
+static inline bool
+is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/**
+ * Reads "digits [ '.' digits ]" from `*pp`, leaving the integral part in
+ * `*whole` and the fraction as `*frac / *scale`. Fraction digits beyond what
+ * fits are dropped. Returns false if no digits were read or the integral part
+ * overflows.
+ */
+static bool
+read_decimal(const char **pp, const char *pe,
+		uint64_t *whole, uint64_t *frac, uint64_t *scale, bool *overflow)
+{
+	const char *p = *pp;
+	uint64_t w = 0, f = 0, s = 1;
+	bool any = false;
+
+	*overflow = false;
+	for (; p < pe && is_digit(*p); p++) {
+		any = true;
+		if (__builtin_mul_overflow(w, 10, &w) ||
+				__builtin_add_overflow(w, (uint64_t)(*p - '0'), &w)) {
+			*overflow = true;
+		}
+	}
+	if (p < pe && *p == '.') {
+		p++;
+		for (int n = 0; p < pe && is_digit(*p); p++, n++) {
+			any = true;
+			if (n < FRAC_DIGITS_MAX) {
+				f = f*10 + (*p - '0');
+				s *= 10;
+			}
+		}
+	}
+
+	*pp = p;
+	*whole = w;
+	*frac = f;
+	*scale = s;
+	return any;
+}
+
+/**
+ * Computes `whole*unit + frac*unit/scale` with overflow checking.
+ */
+static bool
+scale_decimal(uint64_t *out, uint64_t whole, uint64_t frac, uint64_t scale,
+		uint64_t unit)
+{
+	uint64_t v;
+	if (__builtin_mul_overflow(whole, unit, &v)) { return false; }
+	if (frac) {
+		uint64_t q = unit / scale, r = unit % scale;
+		uint64_t part = frac*q + (uint64_t)((double)frac * r / scale);
+		if (__builtin_add_overflow(v, part, &v)) { return false; }
+	}
+	*out = v;
+	return true;
+}
+
+static int64_t
+duration_unit(const char **pp, const char *pe)
+{
+	const char *p = *pp;
+	int64_t unit = 0;
+	size_t n = pe - p;
+
+	if (n >= 2 && p[1] == 's') {
+		switch (p[0]) {
+		case 'n': unit = 1; break;
+		case 'u': unit = NS_PER_US; break;
+		case 'm': unit = NS_PER_MS; break;
+		}
+		if (unit) { *pp = p + 2; return unit; }
+	}
+	if (n >= 3 && (uint8_t)p[0] == 0xc2 && (uint8_t)p[1] == 0xb5 && p[2] == 's') {
+		*pp = p + 3;
+		return NS_PER_US;
+	}
+	if (n >= 1) {
+		switch (p[0]) {
+		case 's': unit = NS_PER_S; break;
+		case 'm': unit = NS_PER_M; break;
+		case 'h': unit = NS_PER_H; break;
+		case 'd': unit = NS_PER_D; break;
+		}
+		if (unit) { *pp = p + 1; }
+	}
+	return unit;
+}
+
+enum tini_result
+tini_duration(int64_t *t, const struct tini *value)
+{
+	if (value == NULL || value->length == 0) {
+		return TINI_DURATION_FORMAT;
+	}
+
+	const char *p = value->start, *pe = p + value->length;
+	bool neg = false;
+	uint64_t total = 0;
+
+	if (*p == '-' || *p == '+') {
+		neg = *p == '-';
+		p++;
+	}
+
+	if (pe - p == 1 && *p == '0') {
+		*t = 0;
+		return TINI_SUCCESS;
+	}
+
+	do {
+		uint64_t whole, frac, scale, v;
+		bool overflow;
+		if (!read_decimal(&p, pe, &whole, &frac, &scale, &overflow)) {
+			return TINI_DURATION_FORMAT;
+		}
+		int64_t unit = duration_unit(&p, pe);
+		if (unit == 0) {
+			return TINI_DURATION_FORMAT;
+		}
+		if (overflow ||
+				!scale_decimal(&v, whole, frac, scale, unit) ||
+				__builtin_add_overflow(total, v, &total)) {
+			return TINI_DURATION_TOO_BIG;
+		}
+	} while (p < pe);
+
+	if (total > (uint64_t)INT64_MAX + neg) {
+		return TINI_DURATION_TOO_BIG;
+	}
+	*t = neg ? (int64_t)(0 - total) : (int64_t)total;
+	return TINI_SUCCESS;
+}
+
+enum tini_result
+tini_size(uint64_t *t, const struct tini *value)
+{
+	if (value == NULL || value->length == 0) {
+		return TINI_SIZE_FORMAT;
+	}
+
+	const char *p = value->start, *pe = p + value->length;
+	uint64_t whole, frac, scale, v;
+	bool overflow;
+
+	if (!read_decimal(&p, pe, &whole, &frac, &scale, &overflow)) {
+		return TINI_SIZE_FORMAT;
+	}
+	while (p < pe && (*p == ' ' || *p == '\t')) { p++; }
+
+	// "K" and "KiB" are powers of 1024, while "kB" and "KB" are powers of 1000
+	uint64_t unit = 1;
+	if (p < pe && *p != 'B') {
+		static const char prefixes[] = "kmgtpe";
+		const char *pre = memchr(prefixes, *p | 0x20, sizeof(prefixes) - 1);
+		if (pre == NULL) {
+			return TINI_SIZE_FORMAT;
+		}
+		unsigned exp = pre - prefixes + 1;
+		uint64_t base = 1024;
+		p++;
+		if (p < pe && *p == 'i') {
+			if (++p == pe || *p != 'B') { return TINI_SIZE_FORMAT; }
+			p++;
+		}
+		else if (p < pe && *p == 'B') {
+			base = 1000;
+			p++;
+		}
+		while (exp--) { unit *= base; }
+	}
+	else if (p < pe) {
+		p++;
+	}
+
+	if (p != pe) {
+		return TINI_SIZE_FORMAT;
+	}
+	if (overflow || !scale_decimal(&v, whole, frac, scale, unit)) {
+		return TINI_SIZE_TOO_BIG;
+	}
+	// a fraction must resolve to whole bytes rather than being truncated
+	if (frac && (unsigned __int128)frac * unit % scale != 0) {
+		return TINI_SIZE_FORMAT;
+	}
+	*t = v;
+	return TINI_SUCCESS;
+}
+
+static bool
+read_fixed(const char **pp, const char *pe, int ndigits, int *out)
+{
+	const char *p = *pp;
+	int v = 0;
+	if (pe - p < ndigits) { return false; }
+	for (int i = 0; i < ndigits; i++, p++) {
+		if (!is_digit(*p)) { return false; }
+		v = v*10 + (*p - '0');
+	}
+	*pp = p;
+	*out = v;
+	return true;
+}
+
+static bool
+read_sep(const char **pp, const char *pe, char sep)
+{
+	if (*pp < pe && **pp == sep) {
+		(*pp)++;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Converts a proleptic Gregorian date into days since 1970-01-01.
+ */
+static int64_t
+days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+	y -= m <= 2;
+	int64_t era = (y >= 0 ? y : y - 399) / 400;
+	unsigned yoe = (unsigned)(y - era * 400);
+	unsigned doy = (153*(m > 2 ? m - 3 : m + 9) + 2)/5 + d - 1;
+	unsigned doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+	return era * 146097 + (int64_t)doe - 719468;
+}
+
+static unsigned
+days_in_month(int y, int m)
+{
+	static const uint8_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	if (m == 2 && (y % 4 == 0 && (y % 100 != 0 || y % 400 == 0))) {
+		return 29;
+	}
+	return days[m - 1];
+}
+
+enum tini_result
+tini_time(int64_t *t, const struct tini *value)
+{
+	if (value == NULL) {
+		return TINI_TIME_FORMAT;
+	}
+
+	const char *p = value->start, *pe = p + value->length;
+	int y, mon, d, h = 0, min = 0, s = 0, oh = 0, om = 0, osign = 0;
+	uint64_t frac = 0, scale = 1;
+
+	if (!read_fixed(&p, pe, 4, &y) || !read_sep(&p, pe, '-') ||
+			!read_fixed(&p, pe, 2, &mon) || !read_sep(&p, pe, '-') ||
+			!read_fixed(&p, pe, 2, &d)) {
+		return TINI_TIME_FORMAT;
+	}
+
+	if (p < pe && (*p == 'T' || *p == 't' || *p == ' ')) {
+		p++;
+		if (!read_fixed(&p, pe, 2, &h) || !read_sep(&p, pe, ':') ||
+				!read_fixed(&p, pe, 2, &min)) {
+			return TINI_TIME_FORMAT;
+		}
+		if (read_sep(&p, pe, ':')) {
+			if (!read_fixed(&p, pe, 2, &s)) {
+				return TINI_TIME_FORMAT;
+			}
+			if (read_sep(&p, pe, '.') || read_sep(&p, pe, ',')) {
+				if (p == pe || !is_digit(*p)) {
+					return TINI_TIME_FORMAT;
+				}
+				for (int n = 0; p < pe && is_digit(*p); p++, n++) {
+					if (n < 9) {
+						frac = frac*10 + (*p - '0');
+						scale *= 10;
+					}
+				}
+			}
+		}
+
+		if (p < pe && (*p == 'Z' || *p == 'z')) {
+			p++;
+		}
+		else if (p < pe && (*p == '+' || *p == '-')) {
+			osign = *p++ == '-' ? -1 : 1;
+			if (!read_fixed(&p, pe, 2, &oh)) {
+				return TINI_TIME_FORMAT;
+			}
+			read_sep(&p, pe, ':');
+			if (!read_fixed(&p, pe, 2, &om)) {
+				return TINI_TIME_FORMAT;
+			}
+		}
+	}
+
+	if (p != pe) {
+		return TINI_TIME_FORMAT;
+	}
+	if (mon < 1 || mon > 12 || d < 1 || (unsigned)d > days_in_month(y, mon) ||
+			h > 23 || min > 59 || s > 60 || oh > 23 || om > 59) {
+		return TINI_TIME_RANGE;
+	}
+
+	int64_t secs = days_from_civil(y, mon, d) * 86400 +
+		h * 3600 + min * 60 + s - osign * (oh * 3600 + om * 60);
+	int64_t ns;
+	if (__builtin_mul_overflow(secs, NS_PER_S, &ns) ||
+			__builtin_add_overflow(ns, (int64_t)(frac * (NS_PER_S / scale)), &ns)) {
+		return TINI_TIME_RANGE;
+	}
+	*t = ns;
+	return TINI_SUCCESS;
+}
@@ -0,0 +1,95 @@
+#include "../include/tini.h"
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+/**
+ * Control bytes other than the whitespace the grammar allows (tab, newline,
+ * vertical tab, form feed and carriage return) are rejected, as is DEL.
+ */
+static inline bool
+is_control(uint8_t c)
+{
+	return (c < 0x20 && (c < '\t' || c > '\r')) || c == 0x7f;
+}
+
+static inline bool
+is_cont(uint8_t c)
+{
+	return (c & 0xc0) == 0x80;
+}
+
+/**
+ * Returns the length of the valid UTF-8 sequence at `p`, or 0 if it is
+ * invalid. Overlong encodings, surrogates and code points above U+10FFFF are
+ * rejected by narrowing the range of the second byte.
+ */
+static size_t
+sequence(const uint8_t *p, const uint8_t *pe)
+{
+	uint8_t c = p[0], lo = 0x80, hi = 0xbf;
+	size_t n;
+
+	if (c < 0xc2) { return 0; }
+	else if (c < 0xe0) { n = 2; }
+	else if (c < 0xf0) {
+		n = 3;
+		if (c == 0xe0) { lo = 0xa0; }
+		else if (c == 0xed) { hi = 0x9f; }
+	}
+	else if (c < 0xf5) {
+		n = 4;
+		if (c == 0xf0) { lo = 0x90; }
+		else if (c == 0xf4) { hi = 0x8f; }
+	}
+	else { return 0; }
+
+	if ((size_t)(pe - p) < n || p[1] < lo || p[1] > hi) {
+		return 0;
+	}
+	for (size_t i = 2; i < n; i++) {
+		if (!is_cont(p[i])) { return 0; }
+	}
+	return n;
+}
+
+const char *
+tini_validate(const char *txt, const char *end, enum tini_result *rc)
+{
+	const uint8_t *p = (const uint8_t *)txt, *pe = (const uint8_t *)end;
+
+	while (p < pe) {
+#ifdef __SSE2__
+		// skip blocks of plain ASCII text sixteen bytes at a time
+		const __m128i sp = _mm_set1_epi8(0x20), del = _mm_set1_epi8(0x7f);
+		const __m128i ws_lo = _mm_set1_epi8('\t' - 1), ws_hi = _mm_set1_epi8('\r' + 1);
+		for (; pe - p >= 16; p += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i *)p);
+			__m128i ws = _mm_and_si128(_mm_cmpgt_epi8(v, ws_lo), _mm_cmplt_epi8(v, ws_hi));
+			__m128i ctl = _mm_or_si128(
+					_mm_andnot_si128(ws, _mm_cmplt_epi8(v, sp)),
+					_mm_cmpeq_epi8(v, del));
+			// bytes with the high bit set compare as negative, so they show
+			// up in the control mask as well as in the sign mask
+			if (_mm_movemask_epi8(ctl) != 0) { break; }
+		}
+#endif
+		// the scalar loops pick up at the block that stopped the vector loop
+		for (; p < pe && *p < 0x80; p++) {
+			if (is_control(*p)) {
+				*rc = TINI_CONTROL_CHAR;
+				return (const char *)p;
+			}
+		}
+		while (p < pe && *p >= 0x80) {
+			size_t n = sequence(p, pe);
+			if (n == 0) {
+				*rc = TINI_INVALID_UTF8;
+				return (const char *)p;
+			}
+			p += n;
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,164 @@
+#include "mu.h"
+#include "../include/tini.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define NFILES 300
+
+struct tenant
+{
+	int64_t id;
+	char name[16];
+};
+
+static const struct tini_field tenant_fields[] = {
+	tini_field_make(struct tenant, id),
+	tini_field_make(struct tenant, name),
+};
+
+struct result
+{
+	struct tenant tenant;
+	unsigned reports;
+	int err;
+	enum tini_result rc;
+	unsigned nerr;
+};
+
+static struct result results[NFILES];
+static char paths[NFILES][64];
+static const char *path_list[NFILES];
+static char dir[] = "/tmp/tini-batch-XXXXXX";
+
+static enum tini_result
+load_tenant(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+
+	if (tini_streq(name, "tenant")) {
+		tini_section_set(section, udata, tenant_fields);
+		return TINI_SUCCESS;
+	}
+	return TINI_MISSING_SECTION;
+}
+
+static void *
+begin(size_t index, void *udata)
+{
+	struct result *r = udata;
+	return &r[index].tenant;
+}
+
+static void
+done(struct tini_ctx *ctx, size_t index, int err, enum tini_result rc,
+		void *udata)
+{
+	struct result *r = (struct result *)udata + index;
+	__atomic_add_fetch(&r->reports, 1, __ATOMIC_RELAXED);
+	r->err = err;
+	r->rc = rc;
+	r->nerr = ctx->nerr;
+}
+
+static void
+setup(void)
+{
+	mu_assert(mkdtemp(dir) != NULL);
+
+	for (int i = 0; i < NFILES; i++) {
+		snprintf(paths[i], sizeof(paths[i]), "%s/%d.ini", dir, i);
+		path_list[i] = paths[i];
+
+		// every tenth file is missing and every seventh has a bad id
+		if (i % 10 == 9) { continue; }
+
+		FILE *f = fopen(paths[i], "w");
+		mu_assert(f != NULL);
+		if (i % 7 == 6) {
+			fprintf(f, "[tenant]\nid = x%d\nname = t%d\n", i, i);
+		}
+		else {
+			fprintf(f, "; tenant %d\n[tenant]\nid = %d\nname = t%d\n", i, i, i);
+		}
+		fclose(f);
+	}
+}
+
+static void
+teardown(void)
+{
+	for (int i = 0; i < NFILES; i++) {
+		unlink(paths[i]);
+	}
+	rmdir(dir);
+}
+
+static void
+check(unsigned options, unsigned nworkers, unsigned depth)
+{
+	memset(results, 0, sizeof(results));
+
+	struct tini_batch batch = {
+		.paths = path_list,
+		.npaths = NFILES,
+		.load_section = load_tenant,
+		.begin = begin,
+		.done = done,
+		.udata = results,
+		.options = options,
+		.depth = depth,
+		.nworkers = nworkers,
+	};
+
+	mu_assert_int_eq(tini_batch_load(&batch), 0);
+
+	for (int i = 0; i < NFILES; i++) {
+		struct result *r = &results[i];
+		mu_assert_int_eq(r->reports, 1);
+		if (i % 10 == 9) {
+			mu_assert_int_eq(r->err, ENOENT);
+		}
+		else if (i % 7 == 6) {
+			mu_assert_int_eq(r->err, 0);
+			mu_assert_int_eq(r->rc, TINI_INTEGER_FORMAT);
+			mu_assert_int_eq(r->nerr, 1);
+		}
+		else {
+			char name[16];
+			snprintf(name, sizeof(name), "t%d", i);
+			mu_assert_int_eq(r->err, 0);
+			mu_assert_int_eq(r->rc, TINI_SUCCESS);
+			mu_assert_int_eq(r->tenant.id, i);
+			mu_assert_str_eq(r->tenant.name, name);
+		}
+	}
+}
+
+static void
+test_uring(void)
+{
+	check(0, 0, 0);
+	check(0, 4, 16);
+}
+
+static void
+test_sync(void)
+{
+	check(TINI_BATCH_SYNC, 0, 0);
+	check(TINI_BATCH_SYNC, 3, 5);
+}
+
+int
+main(void)
+{
+	mu_init("batch");
+	setup();
+	mu_run(test_uring);
+	mu_run(test_sync);
+	teardown();
+}
@@ -0,0 +1,176 @@
+#include "mu.h"
+// the C header may come first without hiding the names in tini::c
+#include "../include/tini.h"
+#include "../include/tini.hpp"
+
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct listen
+{
+	std::string host;
+	uint16_t port;
+	std::chrono::milliseconds timeout;
+};
+
+struct config
+{
+	bool debug;
+	int32_t level;
+	double ratio;
+	char name[8];
+	std::string_view raw;
+	listen http;
+};
+
+static constexpr tini::fields listen_fields{
+	tini::field<&listen::host>("host"),
+	tini::field<&listen::port>("port"),
+	tini::field<&listen::timeout>("timeout"),
+};
+
+static constexpr tini::fields config_fields{
+	tini::field<&config::debug>("debug"),
+	tini::field<&config::level>("level"),
+	tini::field<&config::ratio>("ratio"),
+	tini::field<&config::name>("name"),
+	tini::field<&config::raw>("raw"),
+	tini::section<&config::http, listen_fields>("http"),
+};
+
+static_assert(config_fields.find("ratio") == 2);
+static_assert(config_fields.find("http") == 5);
+static_assert(config_fields.find("missing") == -1);
+
+static void
+test_load(void)
+{
+	static const char cfg[] =
+		"debug = yes\n"
+		"level = -0x10\n"
+		"ratio = 0.25\n"
+		"name = tini\n"
+		"raw = some stuff\n"
+		"\n"
+		"[http]\n"
+		"host = example.com\n"
+		"port = 8080\n"
+		"timeout = 1.5s\n"
+		;
+
+	config target = {};
+	tini::ctx ctx = {};
+
+	mu_assert_int_eq(tini::load<config_fields>(target, ctx, cfg), tini::c::TINI_SUCCESS);
+	mu_assert_int_eq(target.debug, true);
+	mu_assert_int_eq(target.level, -16);
+	mu_assert_flt_eq(target.ratio, 0.25);
+	mu_assert_str_eq(target.name, "tini");
+	mu_assert(target.raw == "some stuff");
+	mu_assert(target.http.host == "example.com");
+	mu_assert_int_eq(target.http.port, 8080);
+	mu_assert_int_eq(target.http.timeout.count(), 1500);
+}
+
+static void
+test_errors(void)
+{
+	static const char cfg[] =
+		"level = 3000000000\n"
+		"name = too long for this\n"
+		"unknown = 1\n"
+		"[http]\n"
+		"port = -1\n"
+		"[nope]\n"
+		;
+
+	config target = {};
+	tini::ctx ctx = {};
+
+	mu_assert_int_eq(tini::load<config_fields>(target, ctx, cfg), tini::c::TINI_INTEGER_TOO_BIG);
+	mu_assert_int_eq(ctx.nerr, 5);
+	mu_assert_int_eq(ctx.err[1].code, tini::c::TINI_STRING_TOO_BIG);
+	mu_assert_int_eq(ctx.err[2].code, tini::c::TINI_MISSING_KEY);
+	mu_assert_int_eq(ctx.err[3].code, tini::c::TINI_INTEGER_NEGATIVE);
+	mu_assert_int_eq(ctx.err[4].code, tini::c::TINI_MISSING_SECTION);
+}
+
+static void
+test_events(void)
+{
+	static const char cfg[] =
+		"a = 1\n"
+		"# comment\n"
+		"[one : x]\n"
+		"b = 2\n"
+		"[two]\n"
+		"c = 3\n"
+		;
+
+	std::vector<std::string_view> seen;
+	for (const auto &ev : tini::events(cfg)) {
+		seen.push_back(tini::view(ev.name));
+		if (ev.type == tini::c::TINI_EVENT_SECTION) {
+			seen.push_back(tini::view(ev.value));
+		}
+	}
+
+	mu_assert_int_eq(seen.size(), 7);
+	mu_assert(seen[0] == "a");
+	mu_assert(seen[1] == "one");
+	mu_assert(seen[2] == "x");
+	mu_assert(seen[3] == "b");
+	mu_assert(seen[4] == "two");
+	mu_assert(seen[5] == "");
+	mu_assert(seen[6] == "c");
+}
+
+static void
+test_events_pipeline(void)
+{
+	static const char cfg[] =
+		"a = 1\n"
+		"b = 2\n"
+		"c = 3\n"
+		"d = 4\n"
+		"[bad\n"
+		;
+
+	auto values = tini::events(cfg)
+		| std::views::filter([](const tini::event &ev) {
+			return ev.type == tini::c::TINI_EVENT_VALUE && tini::view(ev.name) != "a";
+		})
+		| std::views::take(2);
+
+	std::vector<std::string_view> seen;
+	for (const auto &ev : values) {
+		seen.push_back(tini::view(ev.value));
+	}
+
+	mu_assert_int_eq(seen.size(), 2);
+	mu_assert(seen[0] == "2");
+	mu_assert(seen[1] == "3");
+
+	int errors = 0;
+	for (const auto &ev : tini::events(cfg)) {
+		if (ev.type == tini::c::TINI_EVENT_ERROR) {
+			mu_assert_int_eq(ev.code, tini::c::TINI_SYNTAX);
+			mu_assert_int_eq(ev.name.line, 4);
+			errors++;
+		}
+	}
+	mu_assert_int_eq(errors, 1);
+}
+
+int
+main(void)
+{
+	mu_init("hpp");
+
+	mu_run(test_load);
+	mu_run(test_errors);
+	mu_run(test_events);
+	mu_run(test_events_pipeline);
+}
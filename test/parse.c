@@ -144,6 +144,45 @@ test_basic(void)
 	mu_assert_str_eq(target.section1.name, "stuff");
 }
 
+static void
+test_schema(void)
+{
+	static const char cfg[] =
+		"global1 = true\n"
+		"global2 = 12345\n"
+		"\n"
+		"[section1]\n"
+		"name = stuff\n"
+		"[section2]\n"
+		;
+
+	static const struct tini_schema_section sections[] = {
+		tini_schema_global(small_global),
+		tini_schema_section_make(struct small, section1, small_section1),
+	};
+	struct tini_schema schema = tini_schema_make(sections);
+	struct small target = {};
+	struct tini_ctx ctx = tini_ctx_make(NULL, NULL);
+
+	// the linear scan and the compiled hash route the same way
+	for (int i = 0; i < 2; i++) {
+		memset(&target, 0, sizeof(target));
+		mu_assert_int_eq(tini_parse_into(&ctx, &schema, &target, cfg, sizeof(cfg)-1, 0),
+				TINI_MISSING_SECTION);
+		mu_assert_int_eq(ctx.nerr, 1);
+		mu_assert_int_eq(ctx.err[0].node.line, 5);
+		mu_assert_int_eq(target.global1, true);
+		mu_assert_int_eq(target.global2, 12345);
+		mu_assert_str_eq(target.section1.name, "stuff");
+		mu_assert(ctx.load_section == NULL);
+		if (i == 0) { mu_assert_int_eq(tini_schema_compile(&schema), 0); }
+	}
+	mu_assert(tini_schema_find(&schema, "section1", 8) == &sections[1]);
+	mu_assert(tini_schema_find(&schema, "", 0) == &sections[0]);
+	mu_assert(tini_schema_find(&schema, "section", 7) == NULL);
+	tini_schema_free(&schema);
+}
+
 static void
 test_types(void)
 {
@@ -271,15 +310,1650 @@ test_label(void)
 	mu_assert_str_eq(buf, "barbarbarbar");
 }
 
+enum level { LEVEL_DEBUG, LEVEL_INFO, LEVEL_WARN, LEVEL_ERROR };
+
+static const struct tini_enum_value level_values[] = {
+	{ "debug", LEVEL_DEBUG },
+	{ "info", LEVEL_INFO },
+	{ "warn", LEVEL_WARN },
+	{ "error", LEVEL_ERROR },
+};
+
+static const struct tini_enum_value mode_values[] = {
+	{ "active", 1 << 0 },
+	{ "standby", 1 << 1 },
+	{ "drain", 1 << 2 },
+};
+
+static struct tini_enum levels = tini_enum_make(level_values);
+static struct tini_enum modes = tini_enum_make(mode_values);
+
+struct enums
+{
+	uint8_t level;
+	uint32_t mode;
+	uint16_t none;
+};
+
+static const struct tini_field enums_fields[] = {
+	tini_field_enum(struct enums, level, &levels),
+	tini_field_flags(struct enums, mode, &modes),
+	tini_field_flags(struct enums, none, &modes),
+};
+
+static enum tini_result
+load_enums(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)name;
+	(void)label;
+
+	tini_section_set(section, udata, enums_fields);
+	return TINI_SUCCESS;
+}
+
+static void
+test_enum(void)
+{
+	static const char cfg[] =
+		"level = warn\n"
+		"mode = active | drain\n"
+		"none = \n"
+		;
+
+	struct enums target = { .none = 0xff };
+
+	struct tini_ctx ctx = tini_ctx_make(load_enums, &target);
+
+	mu_assert_int_eq(tini_enum_compile(&levels), 0);
+	mu_assert_int_eq(tini_enum_compile(&modes), 0);
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(target.level, LEVEL_WARN);
+	mu_assert_int_eq(target.mode, (1 << 0) | (1 << 2));
+	mu_assert_int_eq(target.none, 0);
+	tini_enum_free(&levels);
+	tini_enum_free(&modes);
+}
+
+static void
+test_invalid_enum(void)
+{
+	static const char cfg[] =
+		"level = verbose\n"
+		"mode = active||drain\n"
+		;
+
+	struct enums target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_enums, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_ENUM_UNKNOWN);
+	mu_assert_int_eq(ctx.nerr, 2);
+	mu_assert_int_eq(ctx.err[0].node.column, 8);
+	mu_assert_int_eq(ctx.err[1].node.line, 1);
+}
+
+struct checked_enums
+{
+	uint8_t level;
+	uint32_t mode;
+};
+
+static const struct tini_field checked_enums_fields[] = {
+	tini_field_enum(struct checked_enums, level, &levels,
+			.check = &tini_check_int(LEVEL_DEBUG, LEVEL_WARN)),
+	tini_field_flags(struct checked_enums, mode, &modes,
+			.check = &tini_check_length(0, 8)),
+};
+
+static enum tini_result
+load_checked_enums(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)name;
+	(void)label;
+
+	tini_section_set(section, udata, checked_enums_fields);
+	return TINI_SUCCESS;
+}
+
+static void
+test_enum_check(void)
+{
+	static const char cfg[] =
+		"level = info\n"
+		"mode = drain\n"
+		"level = error\n"
+		"mode = active | drain\n"
+		;
+
+	struct checked_enums target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_checked_enums, &target);
+
+	mu_assert_int_eq(tini_enum_compile(&levels), 0);
+	mu_assert_int_eq(tini_enum_compile(&modes), 0);
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_VALUE_TOO_BIG);
+	mu_assert_int_eq(ctx.nerr, 2);
+	mu_assert_int_eq(ctx.err[0].node.line, 2);
+	mu_assert_int_eq(ctx.err[1].code, TINI_LENGTH_TOO_LONG);
+	mu_assert_int_eq(target.level, LEVEL_INFO);
+	mu_assert_int_eq(target.mode, 1 << 2);
+	tini_enum_free(&levels);
+	tini_enum_free(&modes);
+}
+
+static const struct tini_enum_value wide_values[] = {
+	{ "small", 1 },
+	{ "large", 300 },
+	{ "negative", -1 },
+};
+
+static struct tini_enum wide = tini_enum_make(wide_values);
+
+struct wide
+{
+	uint8_t narrow;
+	uint64_t full;
+	int16_t offset;
+};
+
+static const struct tini_field wide_fields[] = {
+	tini_field_enum(struct wide, narrow, &wide),
+	tini_field_enum(struct wide, full, &wide),
+	tini_field_enum(struct wide, offset, &wide,
+			.check = &tini_check_int(-1, 1)),
+};
+
+static enum tini_result
+load_wide(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)name;
+	(void)label;
+
+	tini_section_set(section, udata, wide_fields);
+	return TINI_SUCCESS;
+}
+
+static void
+test_enum_range(void)
+{
+	static const char cfg[] =
+		"narrow = small\n"
+		"full = large\n"
+		"narrow = large\n"
+		"offset = negative\n"
+		"offset = large\n"
+		;
+
+	struct wide target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_wide, &target);
+
+	mu_assert_int_eq(tini_enum_compile(&wide), 0);
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_INTEGER_TOO_BIG);
+	mu_assert_int_eq(ctx.nerr, 2);
+	mu_assert_int_eq(ctx.err[0].code, TINI_INTEGER_TOO_BIG);
+	mu_assert_int_eq(ctx.err[0].node.line, 2);
+	mu_assert_int_eq(ctx.err[1].code, TINI_VALUE_TOO_BIG);
+	mu_assert_int_eq(target.narrow, 1);
+	mu_assert_int_eq(target.full, 300);
+	mu_assert_int_eq(target.offset, -1);
+
+	// negative table values fit fields of either signedness
+	static const char negative[] = "narrow = negative\nfull = negative\n";
+	mu_assert_int_eq(tini_parse(&ctx, negative, sizeof(negative)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(target.narrow, UINT8_MAX);
+	mu_assert(target.full == UINT64_MAX);
+	tini_enum_free(&wide);
+}
+
+struct units
+{
+	int64_t timeout;
+	int64_t interval;
+	uint64_t buffer;
+	uint32_t page;
+	uint64_t disk;
+	int64_t cutover;
+	int64_t local;
+};
+
+static const struct tini_field units_fields[] = {
+	tini_field_duration(struct units, timeout),
+	tini_field_duration(struct units, interval),
+	tini_field_size(struct units, buffer),
+	tini_field_size(struct units, page),
+	tini_field_size(struct units, disk),
+	tini_field_time(struct units, cutover),
+	tini_field_time(struct units, local),
+};
+
+static enum tini_result
+load_units(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)name;
+	(void)label;
+
+	tini_section_set(section, udata, units_fields);
+	return TINI_SUCCESS;
+}
+
+static void
+test_units(void)
+{
+	static const char cfg[] =
+		"timeout = 250ms\n"
+		"interval = 1h30m\n"
+		"buffer = 64KiB\n"
+		"page = 1.5K\n"
+		"disk = 2GB\n"
+		"cutover = 2024-02-29T12:30:00.5Z\n"
+		"local = 1970-01-02 01:00:00+01:00\n"
+		;
+
+	struct units target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_units, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(target.timeout, 250000000LL);
+	mu_assert_int_eq(target.interval, 5400LL * 1000000000LL);
+	mu_assert_uint_eq(target.buffer, 65536);
+	mu_assert_uint_eq(target.page, 1536);
+	mu_assert_uint_eq(target.disk, 2000000000ULL);
+	mu_assert_int_eq(target.cutover, 1709209800500000000LL);
+	mu_assert_int_eq(target.local, 86400LL * 1000000000LL);
+}
+
+static void
+test_invalid_units(void)
+{
+	static const char cfg[] =
+		"timeout = 250\n"
+		"interval = 9999999999999h\n"
+		"buffer = 12XB\n"
+		"page = 8GiB\n"
+		"disk = 1.5B\n"
+		"cutover = 2023-02-29\n"
+		"local = 2023-01-01T00\n"
+		;
+
+	struct units target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_units, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_DURATION_FORMAT);
+	mu_assert_int_eq(ctx.nerr, 7);
+	mu_assert_int_eq(ctx.err[1].code, TINI_DURATION_TOO_BIG);
+	mu_assert_int_eq(ctx.err[2].code, TINI_SIZE_FORMAT);
+	mu_assert_int_eq(ctx.err[3].code, TINI_SIZE_TOO_BIG);
+	mu_assert_int_eq(ctx.err[4].code, TINI_SIZE_FORMAT);
+	mu_assert_int_eq(ctx.err[5].code, TINI_TIME_RANGE);
+	mu_assert_int_eq(ctx.err[6].code, TINI_TIME_FORMAT);
+}
+
+struct server
+{
+	char host[32];
+	uint16_t port;
+	uint32_t workers;
+};
+
+static const struct server server_defaults = {
+	.host = "localhost",
+	.workers = 4,
+};
+
+static const struct tini_field server_fields[] = {
+	tini_field_make(struct server, host),
+	tini_field_make(struct server, port, .flags = TINI_REQUIRED),
+	tini_field_make(struct server, workers),
+};
+
+static enum tini_result
+load_server(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+
+	if (tini_streq(name, "server")) {
+		tini_section_set_defaults(section, udata, server_fields, &server_defaults);
+		return TINI_SUCCESS;
+	}
+	return TINI_MISSING_SECTION;
+}
+
+static void
+test_defaults(void)
+{
+	static const char cfg[] =
+		"[server]\n"
+		"port = 8080\n"
+		;
+
+	struct server target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_server, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_SUCCESS);
+	mu_assert_str_eq(target.host, "localhost");
+	mu_assert_int_eq(target.port, 8080);
+	mu_assert_int_eq(target.workers, 4);
+}
+
+static void
+test_required(void)
+{
+	static const char cfg[] =
+		"[server]\n"
+		"host = example.com\n"
+		;
+
+	struct server target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_server, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_REQUIRED_KEY);
+	mu_assert_int_eq(ctx.nerr, 1);
+	mu_assert_str_eq(ctx.err[0].arg, "port");
+	mu_assert_int_eq(ctx.err[0].node.line, 0);
+}
+
+static void
+test_duplicate(void)
+{
+	static const char cfg[] =
+		"[server]\n"
+		"port = 80\n"
+		"port = 8080\n"
+		;
+
+	struct server target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_server, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(target.port, 8080);
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, TINI_DENY_DUPLICATES), TINI_DUPLICATE_KEY);
+	mu_assert_int_eq(ctx.nerr, 1);
+	mu_assert_int_eq(ctx.err[0].node.line, 2);
+}
+
+static void
+test_repeated_section(void)
+{
+	static const char cfg[] =
+		"[server]\n"
+		"host = example.com\n"
+		"[server]\n"
+		"port = 80\n"
+		"[server]\n"
+		"port = 8080\n"
+		;
+
+	struct server target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_server, &target);
+
+	// a repeated header merges into the section instead of restoring defaults
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_SUCCESS);
+	mu_assert_str_eq(target.host, "example.com");
+	mu_assert_int_eq(target.port, 8080);
+	mu_assert_int_eq(target.workers, 4);
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, TINI_DENY_DUPLICATES), TINI_DUPLICATE_KEY);
+	mu_assert_int_eq(ctx.nerr, 1);
+	mu_assert_int_eq(ctx.err[0].node.line, 5);
+}
+
+static enum tini_result
+load_global_server(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+
+	if (name->length == 0) {
+		tini_section_set_defaults(section, udata, server_fields, &server_defaults);
+		return TINI_SUCCESS;
+	}
+	return TINI_MISSING_SECTION;
+}
+
+static void
+test_required_global(void)
+{
+	struct server target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_global_server, &target);
+
+	// the global section is only loaded once the text has a global key
+	mu_assert_int_eq(tini_parse(&ctx, "", 0, 0), TINI_SUCCESS);
+	mu_assert_int_eq(ctx.nerr, 0);
+	mu_assert_str_eq(target.host, "");
+
+	mu_assert_int_eq(tini_parse(&ctx, "[x]\n", 4, 0), TINI_MISSING_SECTION);
+	mu_assert_int_eq(ctx.nerr, 1);
+
+	mu_assert_int_eq(tini_parse(&ctx, "workers = 2\n", 12, 0), TINI_REQUIRED_KEY);
+	mu_assert_int_eq(ctx.nerr, 1);
+	mu_assert_str_eq(ctx.err[0].arg, "port");
+	mu_assert_str_eq(target.host, "localhost");
+
+	mu_assert_int_eq(tini_parse(&ctx, "port = 1\n", 9, 0), TINI_SUCCESS);
+	mu_assert_int_eq(target.port, 1);
+}
+
+static size_t batch_calls;
+
+static size_t
+count_batch(const struct tini_section *section,
+		struct tini_pair *pairs, size_t n, void *udata)
+{
+	batch_calls++;
+	mu_assert(n <= 2);
+	return tini_assign_batch(section, pairs, n, udata);
+}
+
+static enum tini_result
+load_server_batch(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	enum tini_result rc = load_server(section, name, label, udata);
+	section->assign_batch = count_batch;
+	section->batch = 2;
+	return rc;
+}
+
+static void
+test_batch(void)
+{
+	static const char cfg[] =
+		"[server]\n"
+		"workers = 8\n"
+		"host = example.com\n"
+		"bogus = 1\n"
+		"port = 70000\n"
+		"port = 8080\n"
+		;
+
+	struct server target = {};
+
+	struct tini_ctx ctx = tini_ctx_make(load_server, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, TINI_BATCH), TINI_MISSING_KEY);
+	mu_assert_int_eq(ctx.nerr, 2);
+	mu_assert_int_eq(ctx.err[0].node.line, 3);
+	mu_assert_int_eq(ctx.err[1].code, TINI_INTEGER_TOO_BIG);
+	mu_assert_int_eq(ctx.err[1].node.line, 4);
+	mu_assert_str_eq(target.host, "example.com");
+	mu_assert_int_eq(target.port, 8080);
+	mu_assert_int_eq(target.workers, 8);
+
+	ctx = (struct tini_ctx)tini_ctx_make(load_server_batch, &target);
+	target = (struct server){};
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_MISSING_KEY);
+	mu_assert_int_eq(ctx.nerr, 2);
+	mu_assert_int_eq(batch_calls, 3);
+	mu_assert_int_eq(target.port, 8080);
+}
+
+static size_t assign_calls;
+
+static enum tini_result
+count_assign(const struct tini_section *section,
+		const struct tini *key,
+		const struct tini *value,
+		void *udata)
+{
+	(void)section;
+	(void)key;
+	(void)value;
+	(void)udata;
+
+	assign_calls++;
+	return TINI_SUCCESS;
+}
+
+static enum tini_result
+load_assign(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)name;
+	(void)label;
+	(void)udata;
+
+	section->assign = count_assign;
+	return TINI_SUCCESS;
+}
+
+static void
+test_batch_assign(void)
+{
+	static const char cfg[] =
+		"[server]\n"
+		"port = 8080\n"
+		"bogus = 1\n"
+		;
+
+	struct tini_ctx ctx = tini_ctx_make(load_assign, NULL);
+
+	// a custom assign is not bypassed by batching
+	assign_calls = 0;
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, TINI_BATCH), TINI_SUCCESS);
+	mu_assert_int_eq(assign_calls, 2);
+}
+
+struct limits
+{
+	uint32_t workers;
+	char name[16];
+	double ratio;
+	int64_t timeout;
+	char service[16];
+};
+
+static struct tini_check name_check = tini_check_length(2, 8);
+
+static const struct tini_field limits_fields[] = {
+	tini_field_make(struct limits, workers, .check = &tini_check_uint(1, 256)),
+	tini_field_make(struct limits, name, .check = &name_check),
+	tini_field_make(struct limits, ratio, .check = &tini_check_number(0, 1)),
+	tini_field_duration(struct limits, timeout,
+			.check = &tini_check_int(1000000000, INT64_MAX)),
+	tini_field_make(struct limits, service,
+			.check = &(struct tini_check){ .prefix = "svc-" }),
+};
+
+static enum tini_result
+load_limits(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)name;
+	(void)label;
+
+	tini_section_set(section, udata, limits_fields);
+	return TINI_SUCCESS;
+}
+
+static void
+test_check(void)
+{
+	static const char good[] =
+		"workers = 256\n"
+		"name = web-01\n"
+		"ratio = 0.5\n"
+		"timeout = 2s\n"
+		"service = svc-api\n"
+		;
+
+	static const char bad[] =
+		"workers = 0\n"
+		"workers = 300\n"
+		"name = x\n"
+		"name = toolongname\n"
+		"name = Web_01\n"
+		"ratio = 1.5\n"
+		"timeout = 10ms\n"
+		"service = api\n"
+		;
+
+	tini_check_charset(&name_check, "a-z0-9-");
+
+	struct limits target = {};
+	struct tini_ctx ctx = tini_ctx_make(load_limits, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, good, sizeof(good)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(target.workers, 256);
+	mu_assert_str_eq(target.name, "web-01");
+	mu_assert_int_eq(target.timeout, 2000000000);
+
+	mu_assert_int_eq(tini_parse(&ctx, bad, sizeof(bad)-1, 0), TINI_VALUE_TOO_SMALL);
+	mu_assert_int_eq(ctx.nerr, 8);
+	mu_assert_int_eq(ctx.err[1].code, TINI_VALUE_TOO_BIG);
+	mu_assert_int_eq(ctx.err[2].code, TINI_LENGTH_TOO_SHORT);
+	mu_assert_int_eq(ctx.err[3].code, TINI_LENGTH_TOO_LONG);
+	mu_assert_int_eq(ctx.err[4].code, TINI_VALUE_PATTERN);
+	mu_assert_int_eq(ctx.err[4].node.line, 4);
+	mu_assert_int_eq(ctx.err[4].node.column, 7);
+	mu_assert_int_eq(ctx.err[5].code, TINI_VALUE_TOO_BIG);
+	mu_assert_int_eq(ctx.err[6].code, TINI_VALUE_TOO_SMALL);
+	mu_assert_int_eq(ctx.err[7].code, TINI_VALUE_PATTERN);
+
+	// values that fail a check leave the target untouched
+	mu_assert_int_eq(target.workers, 256);
+	mu_assert_str_eq(target.name, "web-01");
+	mu_assert_int_eq(target.timeout, 2000000000);
+
+	// multiline values are checked as the text they join to
+	static const char joined[] =
+		"name = <<EOF\n"
+		"web-02\n"
+		"EOF\n"
+		"service = svc-\\\n"
+		"    api\n"
+		;
+	mu_assert_int_eq(tini_parse(&ctx, joined, sizeof(joined)-1, TINI_MULTILINE),
+			TINI_SUCCESS);
+	mu_assert_str_eq(target.name, "web-02");
+	mu_assert_str_eq(target.service, "svc-api");
+
+	static const char badjoined[] =
+		"name = <<EOF\n"
+		"web\n"
+		"03\n"
+		"EOF\n"
+		"name = web-\\\n"
+		"  toolong\n"
+		"service = s\\\n"
+		"  vc-api\n"
+		;
+	mu_assert_int_eq(tini_parse(&ctx, badjoined, sizeof(badjoined)-1, TINI_MULTILINE),
+			TINI_VALUE_PATTERN);
+	mu_assert_int_eq(ctx.nerr, 2);
+	mu_assert_int_eq(ctx.err[1].code, TINI_LENGTH_TOO_LONG);
+	mu_assert_str_eq(target.name, "web-02");
+	mu_assert_str_eq(target.service, "svc-api");
+}
+
+static enum tini_result
+load_backend(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+
+	struct server *servers = udata;
+	if (name->length != 1 || name->start[0] < 'a' || name->start[0] > 'e') {
+		return TINI_MISSING_SECTION;
+	}
+	tini_section_set_defaults(section, &servers[name->start[0] - 'a'],
+			server_fields, &server_defaults);
+	return TINI_SUCCESS;
+}
+
+static void
+test_inherit(void)
+{
+	static const char cfg[] =
+		"[a]\n"
+		"host = base.example.com\n"
+		"port = 80\n"
+		"workers = 16\n"
+		"[b : a]\n"
+		"port = 8080\n"
+		"[c : b]\n"
+		"workers = 2\n"
+		"[d : x]\n"
+		"port = 1\n"
+		"[e : e]\n"
+		"port = 2\n"
+		;
+
+	struct server servers[5] = {};
+	struct tini_ctx ctx = tini_ctx_make(load_backend, servers);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, TINI_INHERIT), TINI_MISSING_PARENT);
+	mu_assert_int_eq(ctx.nerr, 2);
+	mu_assert_int_eq(ctx.err[0].node.line, 8);
+	mu_assert_int_eq(ctx.err[0].node.column, 5);
+	mu_assert_int_eq(ctx.err[1].code, TINI_INHERIT_CYCLE);
+
+	mu_assert_str_eq(servers[1].host, "base.example.com");
+	mu_assert_int_eq(servers[1].port, 8080);
+	mu_assert_int_eq(servers[1].workers, 16);
+	mu_assert_str_eq(servers[2].host, "base.example.com");
+	mu_assert_int_eq(servers[2].port, 8080);
+	mu_assert_int_eq(servers[2].workers, 2);
+
+	// sections without a parent start from the defaults
+	mu_assert_str_eq(servers[3].host, "localhost");
+	mu_assert_int_eq(servers[3].port, 1);
+
+	// without the flag, labels do not inherit
+	memset(servers, 0, sizeof(servers));
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_REQUIRED_KEY);
+	mu_assert_str_eq(servers[1].host, "localhost");
+
+	static const char again[] =
+		"[a]\n"
+		"host = base.example.com\n"
+		"port = 80\n"
+		"[b : a]\n"
+		"port = 8080\n"
+		"[b : a]\n"
+		"workers = 3\n"
+		"[c : d]\n"
+		"port = 1\n"
+		"[d : c]\n"
+		"port = 2\n"
+		;
+
+	// a repeated header merges instead of copying the parent again
+	memset(servers, 0, sizeof(servers));
+	mu_assert_int_eq(tini_parse(&ctx, again, sizeof(again)-1, TINI_INHERIT), TINI_MISSING_PARENT);
+	mu_assert_str_eq(servers[1].host, "base.example.com");
+	mu_assert_int_eq(servers[1].port, 8080);
+	mu_assert_int_eq(servers[1].workers, 3);
+
+	// a cycle through another section is caught as well as a direct one
+	mu_assert_int_eq(ctx.nerr, 2);
+	mu_assert_int_eq(ctx.err[0].node.line, 7);
+	mu_assert_int_eq(ctx.err[1].code, TINI_INHERIT_CYCLE);
+	mu_assert_int_eq(ctx.err[1].node.line, 9);
+	mu_assert_str_eq(servers[3].host, "localhost");
+	mu_assert_int_eq(servers[3].port, 2);
+}
+
+static enum tini_result
+load_any(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)name;
+	(void)label;
+	(void)udata;
+
+	static struct { struct tini value; } target;
+	static const struct tini_field fields[] = {
+		tini_field_make(__typeof__(target), value),
+	};
+	tini_section_set(section, &target, fields);
+	return TINI_SUCCESS;
+}
+
+static void
+test_validate(void)
+{
+	static const struct {
+		const char *txt;
+		size_t len;
+		int at;
+		enum tini_result rc;
+	} cases[] = {
+		{ "plain ascii text that spans more than one vector\n\t\r", 0, -1, 0 },
+		{ "h\xc3\xa9llo \xe2\x9c\x93 \xf0\x9f\x98\x80 and more ascii after it", 0, -1, 0 },
+		{ "overlong \xc0\x80", 0, 9, TINI_INVALID_UTF8 },
+		{ "overlong \xe0\x80\xaf", 0, 9, TINI_INVALID_UTF8 },
+		{ "surrogate \xed\xa0\x80", 0, 10, TINI_INVALID_UTF8 },
+		{ "too big \xf4\x90\x80\x80", 0, 8, TINI_INVALID_UTF8 },
+		{ "truncated \xe2\x9c", 0, 10, TINI_INVALID_UTF8 },
+		{ "stray \x80 continuation", 0, 6, TINI_INVALID_UTF8 },
+		{ "a long line of ascii before a nul \0", 36, 34, TINI_CONTROL_CHAR },
+		{ "delete \x7f", 0, 7, TINI_CONTROL_CHAR },
+		{ "escape \x1b[0m after", 0, 7, TINI_CONTROL_CHAR },
+	};
+
+	for (size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); i++) {
+		const char *txt = cases[i].txt;
+		size_t len = cases[i].len ? cases[i].len : strlen(txt);
+		enum tini_result rc = TINI_SUCCESS;
+		const char *bad = tini_validate(txt, txt + len, &rc);
+		if (cases[i].at < 0) {
+			mu_assert(bad == NULL);
+		}
+		else {
+			mu_assert_int_eq(bad - txt, cases[i].at);
+			mu_assert_int_eq(rc, cases[i].rc);
+		}
+	}
+
+	static const char cfg[] =
+		"; comment with \xff\n"
+		"value = ok \xe2\x9c\x93\n"
+		"value = bad\x01\n"
+		"value = \xed\xbf\xbf\n"
+		;
+
+	struct tini_ctx ctx = tini_ctx_make(load_any, NULL);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, TINI_VALIDATE), TINI_INVALID_UTF8);
+	mu_assert_int_eq(ctx.nerr, 3);
+	mu_assert_int_eq(ctx.err[0].node.line, 0);
+	mu_assert_int_eq(ctx.err[0].node.column, 15);
+	mu_assert_int_eq(ctx.err[1].code, TINI_CONTROL_CHAR);
+	mu_assert_int_eq(ctx.err[1].node.line, 2);
+	mu_assert_int_eq(ctx.err[1].node.column, 11);
+	mu_assert_int_eq(ctx.err[2].code, TINI_INVALID_UTF8);
+	mu_assert_int_eq(ctx.err[2].node.line, 3);
+}
+
+static void
+test_render(void)
+{
+	static const char cfg[] =
+		"[server]\n"
+		"port = 99999\n"
+		"\thost\n"
+		;
+
+	static const char text[] =
+		"a\"b.ini:2:8: error: integer too large\n"
+		"    port = 99999\n"
+		"           ^~~~~\n"
+		"a\"b.ini:3:1: error: invalid syntax\n"
+		"    \thost\n"
+		"    ^\n"
+		;
+
+	static const char json[] =
+		"{\"file\":\"a\\\"b.ini\",\"line\":2,\"column\":8,\"length\":5,"
+		"\"code\":6,\"message\":\"integer too large\"}\n"
+		"{\"file\":\"a\\\"b.ini\",\"line\":3,\"column\":1,\"length\":1,"
+		"\"code\":1,\"message\":\"invalid syntax\"}\n"
+		;
+
+	struct server target = {};
+	struct tini_ctx ctx = tini_ctx_make(load_server, &target);
+	struct tini_render r;
+	char buf[1024];
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_INTEGER_TOO_BIG);
+	mu_assert_int_eq(ctx.nerr, 2);
+
+	tini_render_begin(&r, TINI_FORMAT_TEXT, buf, sizeof(buf));
+	tini_render_errors(&r, &ctx, "a\"b.ini");
+	mu_assert_int_eq(tini_render_end(&r), sizeof(text)-1);
+	mu_assert(memcmp(buf, text, sizeof(text)-1) == 0);
+
+	tini_render_begin(&r, TINI_FORMAT_JSON, buf, sizeof(buf));
+	tini_render_errors(&r, &ctx, "a\"b.ini");
+	mu_assert_int_eq(tini_render_end(&r), sizeof(json)-1);
+	mu_assert(memcmp(buf, json, sizeof(json)-1) == 0);
+
+	// a short buffer is filled and the full length is still reported
+	tini_render_begin(&r, TINI_FORMAT_JSON, buf, 10);
+	tini_render_errors(&r, &ctx, "a\"b.ini");
+	mu_assert_int_eq(tini_render_end(&r), sizeof(json)-1);
+	mu_assert(memcmp(buf, json, 10) == 0);
+
+	tini_render_begin(&r, TINI_FORMAT_SARIF, buf, sizeof(buf));
+	tini_render_errors(&r, &ctx, "a.ini");
+	tini_render_errors(&r, &ctx, "b.ini");
+	size_t n = tini_render_end(&r);
+	mu_assert(n < sizeof(buf));
+	buf[n] = '\0';
+	mu_assert(strncmp(buf, "{\"version\":\"2.1.0\",", 19) == 0);
+	mu_assert(strstr(buf, "\"region\":{\"startLine\":3,\"startColumn\":1,\"charLength\":1}") != NULL);
+	mu_assert(strstr(buf, "}},{") == NULL);
+	mu_assert(strstr(buf, "}]},{\"ruleId\"") != NULL);
+	mu_assert(strcmp(buf + n - 5, "]}]}\n") == 0);
+
+	// the argument is escaped into the same message text
+	tini_render_begin(&r, TINI_FORMAT_SARIF, buf, sizeof(buf));
+	tini_render_node(&r, &ctx, &ctx.err[0].node, "a.ini", TINI_REQUIRED_KEY, NULL, "p\"ort");
+	n = tini_render_end(&r);
+	mu_assert(n < sizeof(buf));
+	buf[n] = '\0';
+	mu_assert(strstr(buf, "\"message\":{\"text\":\"required key not set: p\\\"ort\"}") != NULL);
+}
+
+struct sink
+{
+	char buf[512];
+	size_t len;
+};
+
+static int
+sink_write(const char *buf, size_t len, void *udata)
+{
+	struct sink *s = udata;
+	if (len > sizeof(s->buf) - s->len) {
+		return -1;
+	}
+	memcpy(s->buf + s->len, buf, len);
+	s->len += len;
+	return 0;
+}
+
+static void
+test_json(void)
+{
+	static const char cfg[] =
+		"name = \"x\"\\\n"
+		"[server]\n"
+		"port = 80\n"
+		"[server : b]\n"
+		"host = a\tb\n"
+		;
+
+	static const char object[] =
+		"{\"name\":\"\\\"x\\\"\\\\\",\"server\":{\"port\":80},"
+		"\"server:b\":{\"host\":\"a\\tb\"}}\n"
+		;
+
+	static const char lines[] =
+		"{\"section\":\"\",\"key\":\"name\",\"value\":\"\\\"x\\\"\\\\\"}\n"
+		"{\"section\":\"server\",\"key\":\"port\",\"value\":\"80\"}\n"
+		"{\"section\":\"server\",\"label\":\"b\",\"key\":\"host\",\"value\":\"a\\tb\"}\n"
+		;
+
+	struct server target = {};
+	struct tini_ctx typed = tini_ctx_make(load_server, &target);
+	struct tini_ctx plain = tini_ctx_make(NULL, NULL);
+	struct tini_json j;
+	struct sink sink = {};
+	char buf[8];
+
+	// the text is fed in two pieces through a buffer smaller than a value
+	size_t half = strchr(cfg, '[') - cfg;
+	tini_json_begin(&j, TINI_JSON_OBJECT, buf, sizeof(buf), sink_write, &sink);
+	mu_assert_int_eq(tini_json_feed(&j, &typed, cfg, half, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_json_feed(&j, &typed, cfg + half, sizeof(cfg)-1 - half, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_json_end(&j), TINI_SUCCESS);
+	mu_assert_int_eq(sink.len, sizeof(object)-1);
+	mu_assert(memcmp(sink.buf, object, sizeof(object)-1) == 0);
+
+	sink.len = 0;
+	tini_json_begin(&j, TINI_JSON_LINES, buf, sizeof(buf), sink_write, &sink);
+	mu_assert_int_eq(tini_json_feed(&j, &plain, cfg, sizeof(cfg)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_json_end(&j), TINI_SUCCESS);
+	mu_assert_int_eq(sink.len, sizeof(lines)-1);
+	mu_assert(memcmp(sink.buf, lines, sizeof(lines)-1) == 0);
+
+	// typed values that fail to convert are reported and written as strings
+	static const char bad[] = "[server]\nport = x\n";
+	sink.len = 0;
+	tini_json_begin(&j, TINI_JSON_OBJECT, buf, sizeof(buf), sink_write, &sink);
+	mu_assert_int_eq(tini_json_feed(&j, &typed, bad, sizeof(bad)-1, 0), TINI_INTEGER_FORMAT);
+	mu_assert_int_eq(typed.err[0].node.line, 1);
+	mu_assert_int_eq(tini_json_end(&j), TINI_SUCCESS);
+	mu_assert(memcmp(sink.buf, "{\"server\":{\"port\":\"x\"}}\n", sink.len) == 0);
+
+	// a failed write stops the output
+	sink.len = sizeof(sink.buf);
+	tini_json_begin(&j, TINI_JSON_LINES, buf, sizeof(buf), sink_write, &sink);
+	mu_assert_int_eq(tini_json_feed(&j, &plain, cfg, sizeof(cfg)-1, 0), TINI_OUTPUT_ERROR);
+	mu_assert_int_eq(tini_json_end(&j), TINI_OUTPUT_ERROR);
+}
+
+static void
+test_overlay(void)
+{
+	static const char defaults[] = "[server]\nhost = a\nport = 1\n";
+	static const char site[] = "[server]\nport = 2\n";
+	static const char host[] = "[server]\nworkers = 3\n";
+	static const char replaced[] = "[server]\nhost = b\n";
+	static const char broken[] = "[server]\nport\n";
+	static const char bad[] = "; bad port\n[server]\nport = x\n";
+
+	struct server target = {};
+	struct tini_ctx ctx = tini_ctx_make(load_server, &target);
+	struct tini_overlay *ov = tini_overlay_new(3);
+	struct tini value;
+	mu_assert(ov != NULL);
+
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 0, defaults, sizeof(defaults)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 1, site, sizeof(site)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 2, host, sizeof(host)-1, 0), TINI_SUCCESS);
+
+	mu_assert_int_eq(tini_overlay_get(ov, "server", NULL, "port", &value), 1);
+	mu_assert(tini_streq(&value, "2"));
+	mu_assert_int_eq(tini_overlay_get(ov, "server", NULL, "host", NULL), 0);
+	mu_assert_int_eq(tini_overlay_get(ov, "server", "x", "host", NULL), -1);
+	mu_assert_int_eq(tini_overlay_get(ov, "server", NULL, "nope", NULL), -1);
+
+	mu_assert_int_eq(tini_overlay_bind(ov, &ctx, 0), TINI_SUCCESS);
+	mu_assert_str_eq(target.host, "a");
+	mu_assert_int_eq(target.port, 2);
+	mu_assert_int_eq(target.workers, 3);
+
+	// replacing a layer drops the keys it no longer sets
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 1, replaced, sizeof(replaced)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_overlay_get(ov, "server", NULL, "port", NULL), 0);
+	mu_assert_int_eq(tini_overlay_get(ov, "server", NULL, "host", NULL), 1);
+
+	// a layer that fails to parse leaves the previous text in effect
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 1, broken, sizeof(broken)-1, 0), TINI_SYNTAX);
+	mu_assert_int_eq(tini_overlay_get(ov, "server", NULL, "host", NULL), 1);
+
+	memset(&target, 0, sizeof(target));
+	mu_assert_int_eq(tini_overlay_bind(ov, &ctx, 0), TINI_SUCCESS);
+	mu_assert_str_eq(target.host, "b");
+	mu_assert_int_eq(target.port, 1);
+	mu_assert_int_eq(target.workers, 3);
+
+	// errors are located in the layer that supplied the value
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 2, bad, sizeof(bad)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_overlay_bind(ov, &ctx, 0), TINI_INTEGER_FORMAT);
+	mu_assert_int_eq(ctx.nerr, 1);
+	mu_assert_int_eq(ctx.err[0].node.line, 2);
+	mu_assert(ctx.err[0].node.line_start == bad + 20);
+
+	// without any layer setting the port, the required key is reported
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 0, NULL, 0, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 2, NULL, 0, 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_overlay_bind(ov, &ctx, 0), TINI_REQUIRED_KEY);
+	mu_assert_int_eq(ctx.err[0].node.line, 0);
+	mu_assert(ctx.err[0].node.start == replaced + 1);
+
+	tini_overlay_free(ov);
+}
+
+static enum tini_result
+load_collection(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	if (tini_streq(name, "backend")) {
+		return tini_collection_load(udata, section, label);
+	}
+	return TINI_MISSING_SECTION;
+}
+
+struct traced
+{
+	struct server server;
+	struct tini_origin origins[3];
+};
+
+static enum tini_result
+load_traced(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+
+	struct traced *t = udata;
+	if (tini_streq(name, "server")) {
+		tini_section_set_defaults(section, &t->server, server_fields, &server_defaults);
+		section->origins = t->origins;
+		return TINI_SUCCESS;
+	}
+	return TINI_MISSING_SECTION;
+}
+
+static void
+test_origin(void)
+{
+	static const char cfg[] =
+		"[server]\n"
+		"port = 80\n"
+		"\n"
+		"host = a\n"
+		;
+	static const char base[] = "[server]\nhost = base\nport = 1\nworkers = 2\n";
+	static const char local[] = "; local\n[server]\nport = 8080\n";
+	static const char *const files[] = { "base.ini", "local.ini" };
+
+	struct traced t = {};
+	struct tini_ctx ctx = tini_ctx_make(load_traced, &t);
+	const struct tini_origin *o;
+
+	// sections with origins are assigned a pair at a time, even when batched
+	ctx.file = 7;
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, TINI_BATCH), TINI_SUCCESS);
+	o = tini_origin(t.origins, server_fields, "port");
+	mu_assert(o != NULL);
+	mu_assert_int_eq(o->line, 2);
+	mu_assert_int_eq(o->file, 7);
+	o = tini_origin(t.origins, server_fields, "host");
+	mu_assert(o != NULL);
+	mu_assert_int_eq(o->line, 4);
+	mu_assert(tini_origin(t.origins, server_fields, "workers") == NULL);
+	mu_assert(tini_origin(t.origins, server_fields, "nope") == NULL);
+
+	struct tini_overlay *ov = tini_overlay_new(2);
+	mu_assert(ov != NULL);
+	ctx.file = 0;
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 0, base, sizeof(base)-1, 0), TINI_SUCCESS);
+	ctx.file = 1;
+	mu_assert_int_eq(tini_overlay_set(ov, &ctx, 1, local, sizeof(local)-1, 0), TINI_SUCCESS);
+	ctx.file = 0;
+	mu_assert_int_eq(tini_overlay_bind(ov, &ctx, 0), TINI_SUCCESS);
+	mu_assert_int_eq(t.server.port, 8080);
+
+	o = tini_origin(t.origins, server_fields, "port");
+	mu_assert(o != NULL);
+	mu_assert_int_eq(o->file, 1);
+	mu_assert_int_eq(o->line, 3);
+	mu_assert_int_eq(o->layer, 1);
+	o = tini_origin(t.origins, server_fields, "workers");
+	mu_assert(o != NULL);
+	mu_assert_int_eq(o->file, 0);
+	mu_assert_int_eq(o->line, 4);
+	mu_assert_int_eq(o->layer, 0);
+	mu_assert_int_eq(ctx.layer, 0);
+	tini_overlay_free(ov);
+
+	char *dump = NULL;
+	size_t dumplen = 0;
+	FILE *out = open_memstream(&dump, &dumplen);
+	mu_assert(out != NULL);
+	tini_print_origins("server", t.origins, server_fields, 3, files, out);
+	fclose(out);
+	mu_assert_str_eq(dump,
+			"server.host: base.ini:2 (layer 0)\n"
+			"server.port: local.ini:3 (layer 1)\n"
+			"server.workers: base.ini:4 (layer 0)\n");
+	free(dump);
+}
+
+struct dotted
+{
+	struct dotted_tls { char cert[16]; } global, main;
+};
+
+static enum tini_result
+load_dotted(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+
+	static const struct tini_field fields[] = {
+		tini_field_make_as(struct dotted_tls, cert, "tls.cert"),
+	};
+	struct dotted *d = udata;
+	if (name->length == 0) {
+		tini_section_set(section, &d->global, fields);
+		return TINI_SUCCESS;
+	}
+	if (tini_streq(name, "srv.main")) {
+		tini_section_set(section, &d->main, fields);
+		return TINI_SUCCESS;
+	}
+	return TINI_MISSING_SECTION;
+}
+
+static void
+test_patch(void)
+{
+	static const struct tini_schema_section sections[] = {
+		tini_schema_global(small_global),
+		tini_schema_section_make(struct small, section1, small_section1),
+	};
+	static const char ok[] =
+		"# operator overrides\n"
+		"global2 = 7\n"
+		"\n"
+		"[section1] name = patched\n"
+		;
+	static const char bad[] =
+		"global2 = 9\n"
+		"[section1] name = far too long for the field\n"
+		;
+
+	struct tini_schema schema = tini_schema_make(sections);
+	struct small target = { .global2 = 1 };
+	struct tini_ctx ctx = tini_ctx_make(NULL, NULL);
+
+	mu_assert_int_eq(tini_patch_into(&ctx, &schema, &target, ok, sizeof(ok)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(target.global2, 7);
+	mu_assert_str_eq(target.section1.name, "patched");
+
+	// a failing line rolls back the lines before it
+	mu_assert_int_eq(tini_patch_into(&ctx, &schema, &target, bad, sizeof(bad)-1, 0),
+			TINI_STRING_TOO_BIG);
+	mu_assert_int_eq(ctx.err[0].node.line, 1);
+	mu_assert_int_eq(target.global2, 7);
+	mu_assert_str_eq(target.section1.name, "patched");
+
+	mu_assert_int_eq(tini_patch_into(&ctx, &schema, &target, "[nope] x = 1", 12, 0),
+			TINI_MISSING_SECTION);
+	mu_assert_int_eq(tini_patch_into(&ctx, &schema, &target, "[section1] x = 1", 16, 0),
+			TINI_MISSING_KEY);
+	mu_assert_int_eq(tini_patch_into(&ctx, &schema, &target, "global2 = 3\n[section1] name", 26, 0),
+			TINI_SYNTAX);
+	mu_assert_int_eq(ctx.err[0].node.line, 1);
+	mu_assert_int_eq(target.global2, 7);
+
+	// labelled sections and origins go through the context's callback
+	static const char labelled[] = "[server:a] port = 9000\n[ server : a ]workers=8";
+	struct traced t = {};
+	struct tini_ctx traced = tini_ctx_make(load_traced, &t);
+	traced.file = 3;
+	mu_assert_int_eq(tini_patch(&traced, labelled, sizeof(labelled)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(t.server.port, 9000);
+	mu_assert_int_eq(t.server.workers, 8);
+	mu_assert_str_eq(t.server.host, "");
+	const struct tini_origin *o = tini_origin(t.origins, server_fields, "workers");
+	mu_assert(o != NULL);
+	mu_assert_int_eq(o->line, 2);
+	mu_assert_int_eq(o->file, 3);
+
+	mu_assert_int_eq(tini_patch(&traced, "[server:a] workers = x", 22, 0), TINI_INTEGER_FORMAT);
+	mu_assert_int_eq(t.server.workers, 8);
+	mu_assert_int_eq(tini_origin(t.origins, server_fields, "workers")->line, 2);
+	mu_assert_int_eq(tini_patch(&traced, "[server:] workers = 1", 21, 0), TINI_SYNTAX);
+	mu_assert_int_eq(tini_patch(&traced, "[server workers = 1", 19, 0), TINI_SYNTAX);
+
+	// dots in section names and keys do not move the split
+	static const char dotted[] =
+		"tls.cert = global.pem\n"
+		"[srv.main] tls.cert = main.pem\n"
+		;
+	struct dotted d = {};
+	struct tini_ctx dctx = tini_ctx_make(load_dotted, &d);
+	mu_assert_int_eq(tini_patch(&dctx, dotted, sizeof(dotted)-1, 0), TINI_SUCCESS);
+	mu_assert_str_eq(d.global.cert, "global.pem");
+	mu_assert_str_eq(d.main.cert, "main.pem");
+}
+
+static void
+test_collection(void)
+{
+	static const char cfg[] =
+		"[backend : api-1]\n"
+		"port = 1\n"
+		"[backend : api-2]\n"
+		"host = two\n"
+		"port = 2\n"
+		"[backend : api-1]\n"
+		"host = one\n"
+		;
+
+	struct tini_collection backends = tini_collection_make(struct server,
+			server_fields, .defaults = &server_defaults);
+	struct tini_ctx ctx = tini_ctx_make(load_collection, &backends);
+
+	// required keys are checked once all sections are read, so the merged
+	// section has its port
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_SUCCESS);
+	mu_assert_int_eq(backends.count, 2);
+
+	struct server *s = tini_collection_at(&backends, 0);
+	mu_assert_str_eq(tini_collection_label(&backends, 0), "api-1");
+	mu_assert_str_eq(s->host, "one");
+	mu_assert_int_eq(s->port, 1);
+	mu_assert_int_eq(s->workers, 4);
+	mu_assert(tini_collection_find(&backends, "api-1", 5) == s);
+
+	s = tini_collection_find(&backends, "api-2", 5);
+	mu_assert(s == tini_collection_at(&backends, 1));
+	mu_assert_str_eq(s->host, "two");
+	mu_assert(tini_collection_find(&backends, "api-3", 5) == NULL);
+	tini_collection_free(&backends);
+
+	// enough labels to span several blocks and index growth
+	static char many[64 * 1024];
+	size_t n = 0;
+	for (int i = 0; i < 2000; i++) {
+		n += snprintf(many + n, sizeof(many) - n, "[backend : b%d]\nport = %d\n", i, i + 1);
+	}
+	mu_assert(n < sizeof(many));
+	mu_assert_int_eq(tini_parse(&ctx, many, n, 0), TINI_SUCCESS);
+	mu_assert_int_eq(backends.count, 2000);
+	for (int i = 0; i < 2000; i += 111) {
+		char label[16];
+		int len = snprintf(label, sizeof(label), "b%d", i);
+		s = tini_collection_find(&backends, label, len);
+		mu_assert(s == tini_collection_at(&backends, i));
+		mu_assert_int_eq(s->port, i + 1);
+	}
+	tini_collection_free(&backends);
+}
+
+static void
+test_intern(void)
+{
+	static const char cfg[] =
+		"[a]\nhost = example.com\nlevel = info\n"
+		"[b]\nhost = example.com\nlevel = debug\n"
+		;
+
+	struct tini_intern pool = {};
+	struct tini_iter it;
+	struct tini_event ev;
+	const char *host[2] = { NULL }, *level[2] = { NULL };
+	uint32_t id[4];
+	int n = -1;
+
+	tini_iter_init(&it, cfg, sizeof(cfg)-1);
+	while (tini_next(&it, &ev)) {
+		if (ev.type == TINI_EVENT_SECTION) {
+			n++;
+		}
+		else if (ev.type == TINI_EVENT_VALUE && tini_streq(&ev.name, "host")) {
+			host[n] = tini_intern_value(&pool, &ev.value, &id[n]);
+		}
+		else if (ev.type == TINI_EVENT_VALUE) {
+			level[n] = tini_intern_value(&pool, &ev.value, &id[n + 2]);
+		}
+	}
+
+	mu_assert(host[0] != NULL && host[0] == host[1]);
+	mu_assert(host[0] != cfg + 9);
+	mu_assert_str_eq(host[0], "example.com");
+	mu_assert_int_eq(id[0], 0);
+	mu_assert_int_eq(id[1], 0);
+	mu_assert(level[0] != level[1]);
+	mu_assert_int_eq(id[2], 1);
+	mu_assert_int_eq(id[3], 2);
+	mu_assert_int_eq(pool.count, 3);
+	mu_assert(tini_intern_get(&pool, 2) == level[1]);
+	mu_assert(tini_intern_get(&pool, 3) == NULL);
+	mu_assert(tini_intern_find(&pool, "info", 4, NULL) == level[0]);
+	mu_assert(tini_intern_find(&pool, "warn", 4, NULL) == NULL);
+
+	// enough strings to grow the index and fill several chunks
+	char buf[32];
+	for (int i = 0; i < 5000; i++) {
+		int len = snprintf(buf, sizeof(buf), "value-%d", i % 2500);
+		const char *s = tini_intern(&pool, buf, len, &id[0]);
+		mu_assert(s != NULL);
+		if (i >= 2500) {
+			mu_assert_int_eq(id[0], 3 + i - 2500);
+		}
+	}
+	mu_assert_int_eq(pool.count, 2503);
+	mu_assert_str_eq(tini_intern_get(&pool, 2502), "value-2499");
+	mu_assert(tini_intern_find(&pool, "example.com", 11, NULL) == host[0]);
+	tini_intern_free(&pool);
+}
+
+static void
+test_iter(void)
+{
+	static const char cfg[] =
+		"global = 1\n"
+		"; comment\n"
+		"[section1 : label]\n"
+		"name = stuff\n"
+		"[section2]\n"
+		"name = other\n"
+		"[bad\n"
+		;
+
+	struct tini_iter it;
+	struct tini_event ev;
+
+	tini_iter_init(&it, cfg, sizeof(cfg)-1);
+
+	mu_assert(tini_next(&it, &ev));
+	mu_assert_int_eq(ev.type, TINI_EVENT_VALUE);
+	mu_assert(tini_streq(&ev.name, "global"));
+	mu_assert(tini_streq(&ev.value, "1"));
+
+	mu_assert(tini_next(&it, &ev));
+	mu_assert_int_eq(ev.type, TINI_EVENT_SECTION);
+	mu_assert(tini_streq(&ev.name, "section1"));
+	mu_assert_int_eq(ev.value.type, TINI_LABEL);
+	mu_assert(tini_streq(&ev.value, "label"));
+	mu_assert_int_eq(ev.name.line, 0);
+	tini_locate(cfg, &ev.name);
+	mu_assert_int_eq(ev.name.line, 2);
+	mu_assert_int_eq(ev.name.column, 1);
+
+	mu_assert(tini_next(&it, &ev));
+	mu_assert_int_eq(ev.type, TINI_EVENT_VALUE);
+	mu_assert(tini_streq(&ev.value, "stuff"));
+
+	mu_assert(tini_next(&it, &ev));
+	mu_assert_int_eq(ev.type, TINI_EVENT_SECTION);
+	mu_assert_int_eq(ev.value.type, TINI_NONE);
+
+	mu_assert(tini_next(&it, &ev));
+	mu_assert_int_eq(ev.type, TINI_EVENT_VALUE);
+
+	mu_assert(tini_next(&it, &ev));
+	mu_assert_int_eq(ev.type, TINI_EVENT_ERROR);
+	mu_assert_int_eq(ev.code, TINI_SYNTAX);
+	mu_assert_int_eq(ev.name.line, 6);
+
+	mu_assert(!tini_next(&it, &ev));
+	mu_assert(!tini_next(&it, &ev));
+}
+
+static enum tini_result
+load_int_section(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+	(void)udata;
+
+	static struct { int64_t value; } target;
+	static const struct tini_field fields[] = {
+		tini_field_make(__typeof__(target), value),
+	};
+	tini_section_set(section, &target, fields);
+	return tini_streq(name, "s") ? TINI_SUCCESS : TINI_MISSING_SECTION;
+}
+
+static void
+test_locate(void)
+{
+	static const char cfg[] =
+		"; a comment long enough to span several vector loads\n"
+		"[s]\n"
+		"value = 1\n"
+		"value =   x\n"
+		"; another comment long enough to span several vector loads\n"
+		"\n"
+		"value = 1.5\n"
+		"[t]\n"
+		;
+
+	struct tini_ctx ctx = tini_ctx_make(load_int_section, NULL);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_INTEGER_FORMAT);
+	mu_assert_int_eq(ctx.nerr, 3);
+	mu_assert_int_eq(ctx.err[0].node.line, 3);
+	mu_assert_int_eq(ctx.err[0].node.column, 10);
+	mu_assert(ctx.err[0].node.line_start == strstr(cfg, "value =   x"));
+	mu_assert_int_eq(ctx.err[1].node.line, 6);
+	mu_assert_int_eq(ctx.err[1].node.column, 8);
+	mu_assert_int_eq(ctx.err[2].node.line, 7);
+	mu_assert_int_eq(ctx.err[2].node.column, 1);
+
+	struct tini_span span = tini_span_make(cfg, &ctx.err[1].node);
+	mu_assert_int_eq(sizeof(span), 8);
+	struct tini node = tini_span_node(cfg, span, TINI_VALUE);
+	mu_assert(tini_streq(&node, "1.5"));
+	tini_locate(cfg, &node);
+	mu_assert_int_eq(node.line, 6);
+}
+
+static void
+test_recover(void)
+{
+	static const char cfg[] =
+		"global1 = true\n"
+		"global2 12345\n"
+		"[section1\n"
+		"[section1]\n"
+		"=oops\n"
+		"name = stuff\n"
+		"name = x"
+		;
+
+	struct small target = {};
+	struct tini_ctx ctx = tini_ctx_make(load_small, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_SYNTAX);
+	mu_assert_int_eq(ctx.nerr, 1);
+	mu_assert_int_eq(target.section1.name[0], '\0');
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, TINI_RECOVER), TINI_SYNTAX);
+	mu_assert_int_eq(ctx.nerr, 4);
+	mu_assert_int_eq(ctx.err[0].node.line, 1);
+	mu_assert_int_eq(ctx.err[0].node.column, 8);
+	mu_assert_int_eq(ctx.err[1].node.line, 2);
+	mu_assert_int_eq(ctx.err[1].node.column, 9);
+	mu_assert_int_eq(ctx.err[2].node.line, 4);
+	mu_assert_int_eq(ctx.err[2].node.column, 0);
+	mu_assert_int_eq(ctx.err[3].node.line, 6);
+	mu_assert_int_eq(target.global1, true);
+	mu_assert_int_eq(target.global2, 0);
+	// the line after a broken one is bound in the section it belongs to
+	mu_assert_str_eq(target.section1.name, "stuff");
+
+	// keys after a broken header are not bound into the previous section
+	static const char header[] =
+		"[section1]\n"
+		"name = a\n"
+		"[section2\n"
+		"name = b\n"
+		"[section1]\n"
+		;
+
+	target = (struct small){};
+	mu_assert_int_eq(tini_parse(&ctx, header, sizeof(header)-1, TINI_RECOVER), TINI_SYNTAX);
+	mu_assert_int_eq(ctx.nerr, 2);
+	mu_assert_int_eq(ctx.err[1].code, TINI_UNUSED_SECTION);
+	mu_assert_int_eq(ctx.err[1].node.line, 3);
+	mu_assert_str_eq(target.section1.name, "a");
+}
+
+struct multiline
+{
+	char list[16];
+	struct tini sql;
+	char cert[32];
+	int64_t after;
+};
+
+static enum tini_result
+load_multiline(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+
+	static const struct tini_field fields[] = {
+		tini_field_make(struct multiline, list),
+		tini_field_make(struct multiline, sql),
+		tini_field_make(struct multiline, cert),
+		tini_field_make(struct multiline, after),
+	};
+	tini_section_set(section, udata, fields);
+	return tini_streq(name, "s") ? TINI_SUCCESS : TINI_MISSING_SECTION;
+}
+
+static void
+test_multiline(void)
+{
+	static const char cfg[] =
+		"[s]\n"
+		"list = a,\\\n"
+		"    b,\\\n"
+		"    c\n"
+		"sql = select *\n"
+		"\tfrom t\n"
+		"  where x\n"
+		"cert = <<END\n"
+		"-----BEGIN-----\n"
+		"  abc\n"
+		"END\n"
+		"after = 1\n"
+		;
+
+	struct multiline target = {};
+	struct tini_ctx ctx = tini_ctx_make(load_multiline, &target);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, 0), TINI_SYNTAX);
+
+	mu_assert_int_eq(tini_parse(&ctx, cfg, sizeof(cfg)-1, TINI_MULTILINE), TINI_SUCCESS);
+	mu_assert_str_eq(target.list, "a,b,c");
+	mu_assert_str_eq(target.cert, "-----BEGIN-----\n  abc");
+	mu_assert_int_eq(target.after, 1);
+
+	// the bound node refers to the source, a segment at a time
+	mu_assert_int_eq(target.sql.type, TINI_CONTINUED);
+	const char *cursor = NULL;
+	struct tini seg;
+	mu_assert(tini_segment(&target.sql, &cursor, &seg));
+	mu_assert(tini_streq(&seg, "select *"));
+	mu_assert(seg.start == strstr(cfg, "select"));
+	mu_assert(tini_segment(&target.sql, &cursor, &seg));
+	mu_assert(tini_streq(&seg, "\n"));
+	mu_assert(tini_segment(&target.sql, &cursor, &seg));
+	mu_assert(tini_streq(&seg, "from t"));
+	mu_assert_int_eq(tini_length(&target.sql), 23);
+
+	char buf[24];
+	mu_assert_int_eq(tini_str(buf, sizeof(buf), &target.sql), TINI_SUCCESS);
+	mu_assert_str_eq(buf, "select *\nfrom t\nwhere x");
+	mu_assert_int_eq(tini_str(buf, 23, &target.sql), TINI_STRING_TOO_BIG);
+
+	char *copy = tini_copy(&target.sql);
+	mu_assert_str_eq(copy, "select *\nfrom t\nwhere x");
+	struct tini_intern pool = {};
+	const char *a = tini_intern_value(&pool, &target.sql, NULL);
+	mu_assert_str_eq(a, copy);
+	mu_assert(tini_intern(&pool, copy, strlen(copy), NULL) == a);
+	mu_assert(tini_intern_value(&pool, &target.sql, NULL) == a);
+	mu_assert_int_eq(pool.count, 1);
+	tini_intern_free(&pool);
+	free(copy);
+
+	// a backslash continues a line that ends in CRLF
+	static const char crlf[] = "[s]\nlist = a,\\\r\n    b,\\\r\n    c\n";
+	mu_assert_int_eq(tini_parse(&ctx, crlf, sizeof(crlf)-1, TINI_MULTILINE), TINI_SUCCESS);
+	mu_assert_str_eq(target.list, "a,b,c");
+
+	static const char open[] = "[s]\ncert = <<END\nx\n";
+	mu_assert_int_eq(tini_parse(&ctx, open, sizeof(open)-1, TINI_MULTILINE), TINI_SYNTAX);
+	mu_assert_int_eq(ctx.err[0].node.line, 1);
+	mu_assert_int_eq(ctx.err[0].node.column, 7);
+}
+
 int
 main(void)
 {
 	mu_init("parse");
 
 	mu_run(test_basic);
+	mu_run(test_schema);
 	mu_run(test_types);
 	mu_run(test_invalid_too_big);
 	mu_run(test_invalid_int);
 	mu_run(test_label);
+	mu_run(test_enum);
+	mu_run(test_invalid_enum);
+	mu_run(test_enum_range);
+	mu_run(test_enum_check);
+	mu_run(test_units);
+	mu_run(test_invalid_units);
+	mu_run(test_defaults);
+	mu_run(test_required);
+	mu_run(test_duplicate);
+	mu_run(test_repeated_section);
+	mu_run(test_required_global);
+	mu_run(test_batch);
+	mu_run(test_batch_assign);
+	mu_run(test_check);
+	mu_run(test_inherit);
+	mu_run(test_validate);
+	mu_run(test_render);
+	mu_run(test_json);
+	mu_run(test_overlay);
+	mu_run(test_origin);
+	mu_run(test_patch);
+	mu_run(test_collection);
+	mu_run(test_intern);
+	mu_run(test_iter);
+	mu_run(test_locate);
+	mu_run(test_recover);
+	mu_run(test_multiline);
 }
 
@@ -0,0 +1,135 @@
+#include "mu.h"
+#include "../include/tini.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+struct server
+{
+	char host[32];
+	uint16_t port;
+};
+
+static const struct tini_field server_fields[] = {
+	tini_field_make(struct server, host),
+	tini_field_make(struct server, port),
+};
+
+static enum tini_result
+load_server(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+
+	if (tini_streq(name, "server")) {
+		tini_section_set(section, udata, server_fields);
+		return TINI_SUCCESS;
+	}
+	return TINI_MISSING_SECTION;
+}
+
+static void
+publish(struct tini_shm *shm, const char *cfg)
+{
+	struct server target = {};
+	struct tini_ctx ctx = tini_ctx_make(load_server, &target);
+	mu_assert_int_eq(tini_parse(&ctx, cfg, strlen(cfg), 0), TINI_SUCCESS);
+	mu_assert_int_eq(tini_shm_publish(shm, &target, sizeof(target)), 0);
+}
+
+/**
+ * Runs in a forked worker and reports through its exit status: 0 when the
+ * view holds the expected generation and port.
+ */
+static int
+worker(const struct tini_shm *shm, struct tini_shm_view *view,
+		uint64_t gen, uint16_t port)
+{
+	if (tini_shm_attach(shm, view) != 1) { return 1; }
+	if (view->generation != gen) { return 2; }
+	if (view->size != sizeof(struct server)) { return 3; }
+	if (((const struct server *)view->data)->port != port) { return 4; }
+	if (((uintptr_t)view->data & (TINI_SHM_ALIGN - 1)) != 0) { return 5; }
+	if (tini_shm_attach(shm, view) != 0) { return 6; }
+	return 0;
+}
+
+static int
+wait_worker(pid_t pid)
+{
+	int status;
+	mu_assert_int_eq(waitpid(pid, &status, 0), pid);
+	mu_assert(WIFEXITED(status));
+	return WEXITSTATUS(status);
+}
+
+static void
+test_publish(void)
+{
+	struct tini_shm shm;
+	struct tini_shm_view view = {};
+
+	mu_assert_int_eq(tini_shm_init(&shm), 0);
+	mu_assert_int_eq(tini_shm_attach(&shm, &view), -1);
+
+	publish(&shm, "[server]\nhost = a\nport = 80\n");
+
+	pid_t pid = fork();
+	mu_assert(pid >= 0);
+	if (pid == 0) {
+		_exit(worker(&shm, &view, 1, 80));
+	}
+	mu_assert_int_eq(wait_worker(pid), 0);
+
+	// a worker that is already attached picks up the reload
+	int ready[2], reload[2];
+	mu_assert_int_eq(pipe(ready), 0);
+	mu_assert_int_eq(pipe(reload), 0);
+	pid = fork();
+	mu_assert(pid >= 0);
+	if (pid == 0) {
+		char c;
+		int rc = worker(&shm, &view, 1, 80);
+		if (rc == 0 && write(ready[1], "x", 1) == 1 && read(reload[0], &c, 1) == 1) {
+			rc = worker(&shm, &view, 2, 8080);
+		}
+		tini_shm_detach(&view);
+		_exit(rc);
+	}
+	char c;
+	mu_assert_int_eq(read(ready[0], &c, 1), 1);
+	publish(&shm, "[server]\nhost = a\nport = 8080\n");
+	mu_assert_int_eq(write(reload[1], "x", 1), 1);
+	mu_assert_int_eq(wait_worker(pid), 0);
+	for (int i = 0; i < 2; i++) {
+		close(ready[i]);
+		close(reload[i]);
+	}
+
+	// a worker that drops its privileges can still attach
+	pid = fork();
+	mu_assert(pid >= 0);
+	if (pid == 0) {
+		if (geteuid() == 0 && setresuid(65534, 65534, 65534) < 0) { _exit(7); }
+		_exit(worker(&shm, &view, 2, 8080));
+	}
+	mu_assert_int_eq(wait_worker(pid), 0);
+
+	// the region is sealed against writes from the publisher as well
+	mu_assert(write(shm.fd, "x", 1) < 0);
+
+	mu_assert_int_eq(tini_shm_attach(&shm, &view), 1);
+	mu_assert_int_eq(((const struct server *)view.data)->port, 8080);
+	tini_shm_detach(&view);
+	tini_shm_free(&shm);
+}
+
+int
+main(void)
+{
+	mu_init("shm");
+	mu_run(test_publish);
+}
@@ -0,0 +1,301 @@
+#include "mu.h"
+#include "../include/tini.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef TINI_ZLIB
+# include <zlib.h>
+#endif
+
+#define WINDOW 4096
+
+static char text[256 * 1024];
+static size_t textlen;
+
+static void
+make_text(void)
+{
+	textlen = 0;
+	for (int i = 0; textlen < sizeof(text) - 6000; i++) {
+		textlen += snprintf(text + textlen, sizeof(text) - textlen,
+				"[backend : b%d]\nhost = host-%d.example.com\nport = %d\n", i, i, i);
+		// one line longer than the window
+		if (i == 100) {
+			memset(text + textlen, 'x', 5000);
+			textlen += 5000;
+			text[textlen++] = '\n';
+		}
+	}
+	// a final line without a newline
+	textlen += snprintf(text + textlen, sizeof(text) - textlen, "last = 1");
+}
+
+static int
+temp_file(const void *data, size_t len)
+{
+	FILE *f = tmpfile();
+	mu_assert(f != NULL);
+	int fd = dup(fileno(f));
+	fclose(f);
+	mu_assert_int_eq(write(fd, data, len), (ssize_t)len);
+	mu_assert_int_eq(lseek(fd, 0, SEEK_SET), 0);
+	return fd;
+}
+
+static void
+read_all(int fd)
+{
+	static char out[sizeof(text)];
+	struct tini_stream *s = tini_stream_open(fd, WINDOW);
+	mu_assert(s != NULL);
+
+	size_t outlen = 0, windows = 0;
+	const char *txt;
+	ssize_t n;
+	bool partial = false;
+	while ((n = tini_stream_next(s, &txt)) > 0) {
+		// only the end of the input may stop short of a newline
+		mu_assert(!partial);
+		partial = txt[n - 1] != '\n';
+		mu_assert(outlen + n <= textlen);
+		memcpy(out + outlen, txt, n);
+		outlen += n;
+		windows++;
+	}
+	mu_assert_int_eq(n, 0);
+	mu_assert_int_eq(outlen, textlen);
+	mu_assert(memcmp(out, text, textlen) == 0);
+	mu_assert(windows > textlen / (WINDOW * 2));
+	tini_stream_close(s);
+	close(fd);
+}
+
+static void
+test_plain(void)
+{
+	read_all(temp_file(text, textlen));
+
+	int fd = temp_file("", 0);
+	struct tini_stream *s = tini_stream_open(fd, WINDOW);
+	const char *txt;
+	mu_assert(s != NULL);
+	mu_assert_int_eq(tini_stream_next(s, &txt), 0);
+	tini_stream_close(s);
+	close(fd);
+}
+
+static void
+test_plain_header(void)
+{
+	// "HK" passes the zlib header check but is read as text
+	static const char ini[] = "HKEY = 1\n";
+	int fd = temp_file(ini, sizeof(ini) - 1);
+	struct tini_stream *s = tini_stream_open(fd, WINDOW);
+	mu_assert(s != NULL);
+	const char *txt;
+	mu_assert_int_eq(tini_stream_next(s, &txt), sizeof(ini) - 1);
+	mu_assert(memcmp(txt, ini, sizeof(ini) - 1) == 0);
+	mu_assert_int_eq(tini_stream_next(s, &txt), 0);
+	tini_stream_close(s);
+	close(fd);
+}
+
+struct backend
+{
+	char host[32];
+	int port;
+	struct tini note;
+};
+
+struct config
+{
+	char name[16];
+	size_t count;
+	struct backend backends[8192];
+};
+
+static const struct tini_field config_global[] = {
+	tini_field_make(struct config, name),
+};
+
+static const struct tini_field config_backend[] = {
+	tini_field_make(struct backend, host),
+	tini_field_make(struct backend, port, .flags = TINI_REQUIRED),
+	tini_field_make(struct backend, note),
+};
+
+static enum tini_result
+load_config(struct tini_section *section,
+			const struct tini *name,
+			const struct tini *label,
+			void *udata)
+{
+	(void)label;
+
+	struct config *c = udata;
+	if (name->length == 0) {
+		tini_section_set(section, c, config_global);
+		return TINI_SUCCESS;
+	}
+	if (tini_streq(name, "backend") && c->count < 8192) {
+		tini_section_set(section, &c->backends[c->count++], config_backend);
+		return TINI_SUCCESS;
+	}
+	return TINI_MISSING_SECTION;
+}
+
+static char conf[256 * 1024];
+static size_t conflen;
+
+/**
+ * Makes a configuration whose multiline values and errors fall across many
+ * window boundaries.
+ */
+static void
+make_conf(void)
+{
+	conflen = snprintf(conf, sizeof(conf), "# generated\nname = streamed\n");
+	for (int i = 0; conflen < sizeof(conf) - 1000; i++) {
+		conflen += snprintf(conf + conflen, sizeof(conf) - conflen,
+				"[backend]\nhost = host-%d\n", i);
+		if (i % 7 == 0) {
+			conflen += snprintf(conf + conflen, sizeof(conf) - conflen,
+					"note = <<EOF\nfirst %d\n\n  second\nEOF\n", i);
+		}
+		else if (i % 5 == 0) {
+			conflen += snprintf(conf + conflen, sizeof(conf) - conflen,
+					"note = one \\\n two %d\n  three\n", i);
+		}
+		if (i % 53 == 52) {
+			conflen += snprintf(conf + conflen, sizeof(conf) - conflen, "oops\n");
+		}
+		if (i % 61 == 60) {
+			conflen += snprintf(conf + conflen, sizeof(conf) - conflen, "bad = \x01\n");
+		}
+		// some backends miss their required port
+		if (i % 97 != 0) {
+			conflen += snprintf(conf + conflen, sizeof(conf) - conflen, "port = %d\n", i);
+		}
+	}
+}
+
+static void
+bind_all(int fd, int flags)
+{
+	static struct config want, got;
+	struct tini_ctx wctx = tini_ctx_make(load_config, &want);
+	struct tini_ctx gctx = tini_ctx_make(load_config, &got);
+	memset(&want, 0, sizeof(want));
+	memset(&got, 0, sizeof(got));
+
+	enum tini_result wrc = tini_parse(&wctx, conf, conflen, flags), grc;
+	struct tini_stream *s = tini_stream_open(fd, WINDOW);
+	mu_assert(s != NULL);
+	mu_assert_int_eq(tini_stream_parse(s, &gctx, flags, &grc), 0);
+
+	mu_assert_int_eq(grc, wrc);
+	mu_assert_str_eq(got.name, want.name);
+	mu_assert_uint_eq(got.count, want.count);
+	mu_assert(want.count > ((flags & TINI_RECOVER) ? 2000 : 40));
+	for (size_t i = 0; i < want.count; i++) {
+		const struct backend *w = &want.backends[i], *g = &got.backends[i];
+		mu_assert_str_eq(g->host, w->host);
+		mu_assert_int_eq(g->port, w->port);
+		mu_assert_uint_eq(g->note.length, w->note.length);
+		mu_assert(g->note.length == 0 ||
+				memcmp(g->note.start, w->note.start, w->note.length) == 0);
+	}
+
+	mu_assert_uint_eq(gctx.nerr, wctx.nerr);
+	for (unsigned i = 0; i < wctx.nerr && i < 10; i++) {
+		mu_assert_int_eq(gctx.err[i].code, wctx.err[i].code);
+		mu_assert_uint_eq(gctx.err[i].node.line, wctx.err[i].node.line);
+		mu_assert_uint_eq(gctx.err[i].node.column, wctx.err[i].node.column);
+	}
+
+	tini_stream_close(s);
+	close(fd);
+}
+
+static void
+test_bind(void)
+{
+	int all = TINI_MULTILINE | TINI_RECOVER | TINI_VALIDATE;
+	bind_all(temp_file(conf, conflen), all);
+	bind_all(temp_file(conf, conflen), TINI_RECOVER);
+	// without recovery binding stops at the first syntax error
+	bind_all(temp_file(conf, conflen), TINI_MULTILINE | TINI_VALIDATE);
+}
+
+#ifdef TINI_ZLIB
+static size_t
+compress_text(char *out, size_t len, const char *in, size_t inlen, int bits)
+{
+	z_stream z = { 0 };
+	mu_assert_int_eq(deflateInit2(&z, 6, Z_DEFLATED, bits, 8, Z_DEFAULT_STRATEGY), Z_OK);
+	z.next_in = (unsigned char *)in;
+	z.avail_in = inlen;
+	z.next_out = (unsigned char *)out;
+	z.avail_out = len;
+	mu_assert_int_eq(deflate(&z, Z_FINISH), Z_STREAM_END);
+	size_t n = len - z.avail_out;
+	deflateEnd(&z);
+	return n;
+}
+
+static void
+test_gzip(void)
+{
+	static char gz[sizeof(text)];
+
+	size_t n = compress_text(gz, sizeof(gz), text, textlen, 15 + 16);
+	read_all(temp_file(gz, n));
+
+	// concatenated members read as one stream
+	size_t half = textlen / 2;
+	n = compress_text(gz, sizeof(gz), text, half, 15 + 16);
+	n += compress_text(gz + n, sizeof(gz) - n, text + half, textlen - half, 15 + 16);
+	read_all(temp_file(gz, n));
+
+	// compressed input binds like the text it inflates to
+	n = compress_text(gz, sizeof(gz), conf, conflen, 15 + 16);
+	bind_all(temp_file(gz, n), TINI_MULTILINE | TINI_RECOVER | TINI_VALIDATE);
+
+	// a truncated member is an error rather than a short read
+	n = compress_text(gz, sizeof(gz), text, textlen, 15 + 16);
+	int fd = temp_file(gz, n / 2);
+	struct tini_stream *s = tini_stream_open(fd, WINDOW);
+	mu_assert(s != NULL);
+	const char *txt;
+	ssize_t rc;
+	while ((rc = tini_stream_next(s, &txt)) > 0) {}
+	mu_assert_int_eq(rc, -1);
+	mu_assert_int_eq(errno, EBADMSG);
+	tini_stream_close(s);
+	close(fd);
+}
+#else
+static void
+test_gzip(void)
+{
+	int fd = temp_file("\x1f\x8b\x08\0", 4);
+	mu_assert(tini_stream_open(fd, WINDOW) == NULL);
+	mu_assert_int_eq(errno, EPROTONOSUPPORT);
+	close(fd);
+}
+#endif
+
+int
+main(void)
+{
+	mu_init("stream");
+	make_text();
+	make_conf();
+
+	mu_run(test_plain);
+	mu_run(test_plain_header);
+	mu_run(test_bind);
+	mu_run(test_gzip);
+}
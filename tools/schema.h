@@ -0,0 +1,198 @@
+#ifndef TINI_TOOLS_SCHEMA_H
+#define TINI_TOOLS_SCHEMA_H
+
+#include "../include/tini.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * Shared by the command line tools. A schema is an INI file in which each key
+ * names an allowed key and its value is a type, optionally followed by
+ * "required". Keys before the first section describe the global section.
+ */
+
+#define SCHEMA_STRING_MAX (1u << 16)
+
+struct schema_section
+{
+	const char *name;
+	size_t namelen;
+	struct tini_field *fields;
+	size_t nfields;
+};
+
+struct schema
+{
+	struct schema_section *sections;
+	size_t nsections;
+	char *txt;
+};
+
+static char *
+xstrndup(const char *s, size_t n)
+{
+	char *p = malloc(n + 1);
+	if (p == NULL) { perror(program_invocation_short_name); exit(2); }
+	memcpy(p, s, n);
+	p[n] = '\0';
+	return p;
+}
+
+static void *
+xrealloc(void *p, size_t n)
+{
+	p = realloc(p, n);
+	if (p == NULL) { perror(program_invocation_short_name); exit(2); }
+	return p;
+}
+
+static char *
+read_file(const char *path, size_t *len)
+{
+	int fd = open(path, O_RDONLY|O_CLOEXEC);
+	struct stat st;
+	if (fd < 0) { return NULL; }
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	char *buf = xrealloc(NULL, st.st_size + 1);
+	size_t n = 0;
+	while (n < (size_t)st.st_size) {
+		ssize_t rc = read(fd, buf + n, st.st_size - n);
+		if (rc <= 0) { break; }
+		n += rc;
+	}
+	close(fd);
+	buf[n] = '\0';
+	*len = n;
+	return buf;
+}
+
+static const struct {
+	const char *name;
+	enum tini_type type;
+	size_t size;
+} schema_types[] = {
+	{ "string", TINI_STRING, SCHEMA_STRING_MAX },
+	{ "bool", TINI_BOOL, sizeof(bool) },
+	{ "signed", TINI_SIGNED, sizeof(int64_t) },
+	{ "unsigned", TINI_UNSIGNED, sizeof(uint64_t) },
+	{ "number", TINI_NUMBER, sizeof(double) },
+	{ "duration", TINI_DURATION, sizeof(int64_t) },
+	{ "size", TINI_SIZE, sizeof(uint64_t) },
+	{ "time", TINI_TIME, sizeof(int64_t) },
+	{ "any", TINI_NODE, sizeof(struct tini) },
+};
+
+static enum tini_result
+schema_assign(const struct tini_section *section,
+		const struct tini *key,
+		const struct tini *value,
+		void *udata)
+{
+	(void)section;
+
+	struct schema *s = udata;
+	struct schema_section *sec = &s->sections[s->nsections - 1];
+	const char *p = value->start, *pe = p + value->length;
+	const char *word = p;
+	while (p < pe && *p != ' ' && *p != '\t') { p++; }
+	size_t wordlen = p - word;
+	while (p < pe && (*p == ' ' || *p == '\t')) { p++; }
+
+	unsigned flags = 0;
+	if (p < pe) {
+		if ((size_t)(pe - p) != 8 || memcmp(p, "required", 8) != 0) {
+			return TINI_INVALID_TYPE;
+		}
+		flags = TINI_REQUIRED;
+	}
+
+	for (size_t i = 0; i < sizeof(schema_types)/sizeof(schema_types[0]); i++) {
+		if (strlen(schema_types[i].name) == wordlen &&
+				memcmp(schema_types[i].name, word, wordlen) == 0) {
+			struct tini_field f = {
+				.name = xstrndup(key->start, key->length),
+				.size = schema_types[i].size,
+				.type = schema_types[i].type,
+				.flags = flags,
+			};
+			sec->fields = xrealloc(sec->fields, (sec->nfields + 1) * sizeof(f));
+			memcpy(&sec->fields[sec->nfields++], &f, sizeof(f));
+			return TINI_SUCCESS;
+		}
+	}
+	return TINI_INVALID_TYPE;
+}
+
+static enum tini_result
+schema_section(struct tini_section *section,
+		const struct tini *name,
+		const struct tini *label,
+		void *udata)
+{
+	(void)label;
+
+	struct schema *s = udata;
+	s->sections = xrealloc(s->sections, (s->nsections + 1) * sizeof(*s->sections));
+	s->sections[s->nsections++] = (struct schema_section){
+		.name = name->start,
+		.namelen = name->length,
+	};
+	section->assign = schema_assign;
+	return TINI_SUCCESS;
+}
+
+static void
+schema_free(struct schema *s)
+{
+	for (size_t i = 0; i < s->nsections; i++) {
+		struct schema_section *sec = &s->sections[i];
+		for (size_t j = 0; j < sec->nfields; j++) {
+			free((char *)sec->fields[j].name);
+		}
+		free(sec->fields);
+	}
+	free(s->sections);
+	free(s->txt);
+}
+
+static int
+schema_load(struct schema *s, const char *path)
+{
+	size_t len;
+	*s = (struct schema){ .txt = read_file(path, &len) };
+	if (s->txt == NULL) {
+		fprintf(stderr, "%s: %s: %s\n", program_invocation_short_name,
+				path, strerror(errno));
+		return -1;
+	}
+
+	struct tini_ctx ctx = tini_ctx_make(schema_section, s);
+	if (tini_parse(&ctx, s->txt, len, TINI_DENY_DUPLICATES) != TINI_SUCCESS) {
+		tini_print_errors(&ctx, path, stderr);
+		schema_free(s);
+		return -1;
+	}
+	return 0;
+}
+
+static const struct schema_section *
+schema_find(const struct schema *s, const struct tini *name)
+{
+	for (size_t i = 0; i < s->nsections; i++) {
+		const struct schema_section *sec = &s->sections[i];
+		if (tini_eq(name, sec->name, sec->namelen)) {
+			return sec;
+		}
+	}
+	return NULL;
+}
+
+#endif
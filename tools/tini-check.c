@@ -0,0 +1,412 @@
+#include "schema.h"
+
+#include <glob.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#define SCRATCH SCHEMA_STRING_MAX
+
+static const char usage[] =
+	"usage: tini-check [-j jobs] [-s schema] [-f text|json|sarif] [-mruq] path...\n"
+	"\n"
+	"Validates files, directories (every *.ini below them) and globs.\n"
+	"\n"
+	"  -j jobs    number of worker threads (default: online CPUs)\n"
+	"  -s schema  check sections, keys and types against a schema file\n"
+	"  -f format  diagnostic format (default: text)\n"
+	"  -m         accept continuation lines and heredoc values\n"
+	"  -r         keep checking after a syntax error, from the next line\n"
+	"  -u         reject invalid UTF-8 and control characters\n"
+	"  -q         do not print the summary\n"
+	"\n"
+	"A schema is itself an INI file. Each key names an allowed key and its\n"
+	"value is a type (string, bool, signed, unsigned, number, duration, size,\n"
+	"time or any), optionally followed by \"required\". Keys before the first\n"
+	"section describe the global section.\n"
+	"\n"
+	"Exits with 0 if every file is valid, 1 if any file has errors, and 2 on\n"
+	"usage errors or when a file cannot be read.\n";
+
+struct file
+{
+	const char *path;
+	char *out;
+	size_t outlen;
+	size_t size;
+	int err;
+	bool failed;
+};
+
+/**
+ * Each worker owns a range of files and steals from the ranges of the other
+ * workers once its own is exhausted.
+ */
+struct range
+{
+	size_t next;
+	size_t end;
+} __attribute__((aligned(64)));
+
+struct check
+{
+	struct file *files;
+	size_t nfiles;
+	struct range *ranges;
+	unsigned nworkers;
+	const struct schema *schema;
+	enum tini_format format;
+	int flags;
+};
+
+struct worker
+{
+	struct check *check;
+	unsigned id;
+	pthread_t thread;
+	char scratch[SCRATCH] __attribute__((aligned(16)));
+};
+
+static enum tini_result
+accept_any(const struct tini_section *section,
+		const struct tini *key,
+		const struct tini *value,
+		void *udata)
+{
+	(void)section;
+	(void)key;
+	(void)value;
+	(void)udata;
+	return TINI_SUCCESS;
+}
+
+static enum tini_result
+check_section(struct tini_section *section,
+		const struct tini *name,
+		const struct tini *label,
+		void *udata)
+{
+	(void)label;
+
+	struct worker *w = udata;
+	const struct schema *s = w->check->schema;
+
+	if (s == NULL) {
+		section->assign = accept_any;
+		return TINI_SUCCESS;
+	}
+	const struct schema_section *sec = schema_find(s, name);
+	if (sec == NULL) {
+		return TINI_MISSING_SECTION;
+	}
+	section->fields = sec->fields;
+	section->nfields = sec->nfields;
+	section->target = w->scratch;
+	return TINI_SUCCESS;
+}
+
+static void
+check_file(struct worker *w, struct file *f)
+{
+	struct check *c = w->check;
+	int fd = open(f->path, O_RDONLY|O_CLOEXEC);
+	struct stat st;
+	char *txt = NULL;
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		goto error;
+	}
+	f->size = st.st_size;
+	if (f->size > 0) {
+		txt = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (txt == MAP_FAILED) { goto error; }
+		madvise(txt, f->size, MADV_SEQUENTIAL);
+	}
+	close(fd);
+	fd = -1;
+
+	struct tini_ctx ctx = tini_ctx_make(check_section, w);
+	if (tini_parse(&ctx, txt, f->size, c->flags) != TINI_SUCCESS) {
+		struct tini_render r;
+		f->failed = true;
+
+		// SARIF results are rendered as fragments that each start with a
+		// separator, and stitched into a single log by main
+		for (int pass = 0; pass < 2; pass++) {
+			tini_render_begin(&r, c->format == TINI_FORMAT_SARIF ?
+					TINI_FORMAT_JSON : c->format, f->out, f->outlen);
+			r.format = c->format;
+			r.count = 1;
+			tini_render_errors(&r, &ctx, f->path);
+			if (r.pos <= f->outlen) { break; }
+			f->outlen = r.pos;
+			f->out = xrealloc(f->out, f->outlen);
+		}
+		f->outlen = r.pos;
+	}
+
+	if (txt) { munmap(txt, f->size); }
+	return;
+
+error:
+	f->err = errno;
+	if (fd >= 0) { close(fd); }
+}
+
+static bool
+take(struct range *r, size_t *idx)
+{
+	if (__atomic_load_n(&r->next, __ATOMIC_RELAXED) >= r->end) {
+		return false;
+	}
+	*idx = __atomic_fetch_add(&r->next, 1, __ATOMIC_RELAXED);
+	return *idx < r->end;
+}
+
+static void *
+work(void *arg)
+{
+	struct worker *w = arg;
+	struct check *c = w->check;
+	size_t idx;
+
+	for (unsigned i = 0; i < c->nworkers; i++) {
+		struct range *r = &c->ranges[(w->id + i) % c->nworkers];
+		while (take(r, &idx)) {
+			check_file(w, &c->files[idx]);
+		}
+	}
+	return NULL;
+}
+
+struct paths
+{
+	struct file *files;
+	size_t n, cap;
+};
+
+static void
+add_path(struct paths *p, const char *path)
+{
+	if (p->n == p->cap) {
+		p->cap = p->cap ? p->cap * 2 : 256;
+		p->files = xrealloc(p->files, p->cap * sizeof(*p->files));
+	}
+	p->files[p->n++] = (struct file){ .path = path };
+}
+
+static bool
+has_suffix(const char *s, const char *suffix)
+{
+	size_t n = strlen(s), m = strlen(suffix);
+	return n >= m && memcmp(s + n - m, suffix, m) == 0;
+}
+
+static void
+add_tree(struct paths *p, const char *path)
+{
+	struct stat st;
+	if (stat(path, &st) < 0 || !S_ISDIR(st.st_mode)) {
+		add_path(p, xstrndup(path, strlen(path)));
+		return;
+	}
+
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		add_path(p, xstrndup(path, strlen(path)));
+		return;
+	}
+
+	struct dirent *ent;
+	while ((ent = readdir(dir)) != NULL) {
+		if (ent->d_name[0] == '.') { continue; }
+		size_t n = strlen(path) + strlen(ent->d_name) + 2;
+		char *child = xrealloc(NULL, n);
+		snprintf(child, n, "%s/%s", path, ent->d_name);
+		if (ent->d_type == DT_DIR ||
+				(ent->d_type == DT_UNKNOWN && stat(child, &st) == 0 && S_ISDIR(st.st_mode))) {
+			add_tree(p, child);
+			free(child);
+		}
+		else if (has_suffix(child, ".ini")) {
+			add_path(p, child);
+		}
+		else {
+			free(child);
+		}
+	}
+	closedir(dir);
+}
+
+static void
+add_arg(struct paths *p, const char *arg)
+{
+	if (strpbrk(arg, "*?[") == NULL) {
+		add_tree(p, arg);
+		return;
+	}
+
+	glob_t g;
+	if (glob(arg, 0, NULL, &g) != 0) {
+		add_path(p, xstrndup(arg, strlen(arg)));
+		return;
+	}
+	for (size_t i = 0; i < g.gl_pathc; i++) {
+		add_tree(p, g.gl_pathv[i]);
+	}
+	globfree(&g);
+}
+
+static int
+compare_files(const void *a, const void *b)
+{
+	return strcmp(((const struct file *)a)->path, ((const struct file *)b)->path);
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct check c = { .format = TINI_FORMAT_TEXT };
+	struct schema schema;
+	const char *schema_path = NULL;
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	bool quiet = false;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "j:s:f:mruqh")) != -1) {
+		switch (ch) {
+		case 'j':
+			jobs = strtol(optarg, NULL, 10);
+			if (jobs < 1) { fputs(usage, stderr); return 2; }
+			break;
+		case 's': schema_path = optarg; break;
+		case 'f':
+			if (strcmp(optarg, "text") == 0) { c.format = TINI_FORMAT_TEXT; }
+			else if (strcmp(optarg, "json") == 0) { c.format = TINI_FORMAT_JSON; }
+			else if (strcmp(optarg, "sarif") == 0) { c.format = TINI_FORMAT_SARIF; }
+			else { fputs(usage, stderr); return 2; }
+			break;
+		case 'm': c.flags |= TINI_MULTILINE; break;
+		case 'r': c.flags |= TINI_RECOVER; break;
+		case 'u': c.flags |= TINI_VALIDATE; break;
+		case 'q': quiet = true; break;
+		case 'h': fputs(usage, stdout); return 0;
+		default: fputs(usage, stderr); return 2;
+		}
+	}
+	if (optind == argc) {
+		fputs(usage, stderr);
+		return 2;
+	}
+	if (c.format == TINI_FORMAT_TEXT && isatty(STDOUT_FILENO)) {
+		c.format = TINI_FORMAT_COLOR;
+	}
+	if (schema_path) {
+		if (schema_load(&schema, schema_path) < 0) { return 2; }
+		c.schema = &schema;
+	}
+
+	struct paths paths = { 0 };
+	for (int i = optind; i < argc; i++) {
+		add_arg(&paths, argv[i]);
+	}
+	qsort(paths.files, paths.n, sizeof(*paths.files), compare_files);
+	c.files = paths.files;
+	c.nfiles = paths.n;
+
+	if ((size_t)jobs > c.nfiles) { jobs = c.nfiles ? c.nfiles : 1; }
+	c.nworkers = jobs;
+	c.ranges = aligned_alloc(64, c.nworkers * sizeof(*c.ranges));
+	if (c.ranges == NULL) { perror("tini-check"); return 2; }
+	for (unsigned i = 0; i < c.nworkers; i++) {
+		c.ranges[i].next = c.nfiles * i / c.nworkers;
+		c.ranges[i].end = c.nfiles * (i + 1) / c.nworkers;
+	}
+
+	double start = now();
+	struct worker *workers = aligned_alloc(64,
+			(c.nworkers * sizeof(*workers) + 63) & ~(size_t)63);
+	if (workers == NULL) { perror("tini-check"); return 2; }
+	for (unsigned i = 0; i < c.nworkers; i++) {
+		workers[i].check = &c;
+		workers[i].id = i;
+		if (i > 0 && pthread_create(&workers[i].thread, NULL, work, &workers[i]) != 0) {
+			perror("tini-check");
+			return 2;
+		}
+	}
+	work(&workers[0]);
+	for (unsigned i = 1; i < c.nworkers; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+	double elapsed = now() - start;
+
+	// diagnostics are written in path order once every file is checked
+	size_t nfailed = 0, nunread = 0, bytes = 0;
+	bool first = true;
+	if (c.format == TINI_FORMAT_SARIF) {
+		struct tini_render r;
+		char head[256];
+		tini_render_begin(&r, TINI_FORMAT_SARIF, head, sizeof(head));
+		fwrite(head, 1, r.pos, stdout);
+	}
+	for (size_t i = 0; i < c.nfiles; i++) {
+		struct file *f = &c.files[i];
+		bytes += f->size;
+		if (f->err) {
+			fprintf(stderr, "tini-check: %s: %s\n", f->path, strerror(f->err));
+			nunread++;
+			continue;
+		}
+		if (!f->failed) { continue; }
+		nfailed++;
+		const char *out = f->out;
+		size_t len = f->outlen;
+		if (c.format == TINI_FORMAT_SARIF && first && len > 0 && out[0] == ',') {
+			out++;
+			len--;
+		}
+		fwrite(out, 1, len, stdout);
+		first = false;
+	}
+	if (c.format == TINI_FORMAT_SARIF) {
+		struct tini_render r;
+		char tail[16];
+		tini_render_begin(&r, TINI_FORMAT_TEXT, tail, sizeof(tail));
+		r.format = TINI_FORMAT_SARIF;
+		size_t n = tini_render_end(&r);
+		fwrite(tail, 1, n, stdout);
+	}
+	fflush(stdout);
+
+	if (!quiet) {
+		double mib = bytes / (1024.0 * 1024.0);
+		fprintf(stderr,
+				"checked %zu files (%.1f MiB) with %u threads in %.3f s: "
+				"%.0f files/s, %.1f MiB/s, %zu with errors, %zu unreadable\n",
+				c.nfiles, mib, c.nworkers, elapsed,
+				elapsed > 0 ? c.nfiles / elapsed : 0.0,
+				elapsed > 0 ? mib / elapsed : 0.0,
+				nfailed, nunread);
+	}
+
+	for (size_t i = 0; i < c.nfiles; i++) {
+		free((char *)c.files[i].path);
+		free(c.files[i].out);
+	}
+	free(c.files);
+	free(c.ranges);
+	free(workers);
+	if (c.schema) { schema_free(&schema); }
+
+	return nunread ? 2 : nfailed ? 1 : 0;
+}
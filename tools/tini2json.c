@@ -0,0 +1,154 @@
+#include "schema.h"
+
+#define WINDOW (1u << 20)
+#define OUTPUT (1u << 16)
+
+static const char usage[] =
+	"usage: tini2json [-l] [-s schema] [-u] [file]\n"
+	"\n"
+	"Converts an INI file, or standard input, to JSON on standard output.\n"
+	"\n"
+	"  -l         write one JSON object per value (NDJSON)\n"
+	"  -s schema  write booleans and numbers typed by a schema file\n"
+	"  -u         reject invalid UTF-8 and control characters\n"
+	"\n"
+	"Input is read in windows, so memory use does not grow with its size.\n"
+	"Input compressed with gzip is decompressed as it is read.\n";
+
+static int
+write_out(const char *buf, size_t len, void *udata)
+{
+	(void)udata;
+
+	while (len > 0) {
+		ssize_t n = write(STDOUT_FILENO, buf, len);
+		if (n < 0) {
+			if (errno == EINTR) { continue; }
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static enum tini_result
+load_section(struct tini_section *section,
+		const struct tini *name,
+		const struct tini *label,
+		void *udata)
+{
+	(void)label;
+
+	const struct schema_section *sec = schema_find(udata, name);
+	if (sec == NULL) {
+		return TINI_MISSING_SECTION;
+	}
+	section->fields = sec->fields;
+	section->nfields = sec->nfields;
+	return TINI_SUCCESS;
+}
+
+/**
+ * Reports errors from one window with line numbers adjusted by the lines in
+ * the windows before it.
+ */
+static void
+report(struct tini_ctx *ctx, const char *path, uint32_t line)
+{
+	unsigned nerr = ctx->nerr;
+	if (nerr > sizeof(ctx->err)/sizeof(ctx->err[0])) {
+		nerr = sizeof(ctx->err)/sizeof(ctx->err[0]);
+	}
+	for (unsigned i = 0; i < nerr; i++) {
+		ctx->err[i].node.line += line;
+	}
+	tini_print_errors(ctx, path, stderr);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct schema schema;
+	struct tini_ctx ctx = tini_ctx_make(NULL, &schema);
+	enum tini_json_format format = TINI_JSON_OBJECT;
+	const char *schema_path = NULL;
+	const char *path = "<stdin>";
+	int flags = 0, fd = STDIN_FILENO, ch;
+
+	while ((ch = getopt(argc, argv, "ls:uh")) != -1) {
+		switch (ch) {
+		case 'l': format = TINI_JSON_LINES; break;
+		case 's': schema_path = optarg; break;
+		case 'u': flags |= TINI_VALIDATE; break;
+		case 'h': fputs(usage, stdout); return 0;
+		default: fputs(usage, stderr); return 2;
+		}
+	}
+	if (argc - optind > 1) {
+		fputs(usage, stderr);
+		return 2;
+	}
+	if (optind < argc && strcmp(argv[optind], "-") != 0) {
+		path = argv[optind];
+		fd = open(path, O_RDONLY|O_CLOEXEC);
+		if (fd < 0) {
+			fprintf(stderr, "tini2json: %s: %s\n", path, strerror(errno));
+			return 2;
+		}
+	}
+	if (schema_path) {
+		if (schema_load(&schema, schema_path) < 0) { return 2; }
+		ctx.load_section = load_section;
+	}
+
+	static char out[OUTPUT];
+	struct tini_json j;
+	tini_json_begin(&j, format, out, sizeof(out), write_out, NULL);
+
+	// each window ends at a newline, with the partial line after it carried
+	// into the next one by the stream
+	struct tini_stream *s = tini_stream_open(fd, WINDOW);
+	if (s == NULL) {
+		fprintf(stderr, "tini2json: %s: %s\n", path, strerror(errno));
+		if (fd != STDIN_FILENO) { close(fd); }
+		if (schema_path) { schema_free(&schema); }
+		return 2;
+	}
+
+	uint32_t line = 0;
+	enum tini_result rc = TINI_SUCCESS;
+	bool failed = false;
+	const char *buf;
+	ssize_t n;
+
+	while (rc == TINI_SUCCESS && (n = tini_stream_next(s, &buf)) != 0) {
+		if (n < 0) {
+			fprintf(stderr, "tini2json: %s: %s\n", path, strerror(errno));
+			failed = true;
+			break;
+		}
+
+		rc = tini_json_feed(&j, &ctx, buf, n, flags);
+		if (ctx.nerr > 0) {
+			report(&ctx, path, line);
+		}
+		else if (rc == TINI_OUTPUT_ERROR) {
+			fprintf(stderr, "tini2json: %s\n", strerror(errno));
+		}
+
+		struct tini last = { .start = buf + n, .length = 0, .type = TINI_NONE };
+		tini_locate(buf, &last);
+		line += last.line;
+	}
+
+	if (tini_json_end(&j) != TINI_SUCCESS && rc == TINI_SUCCESS) {
+		fprintf(stderr, "tini2json: %s\n", strerror(errno));
+		failed = true;
+	}
+
+	tini_stream_close(s);
+	if (fd != STDIN_FILENO) { close(fd); }
+	if (schema_path) { schema_free(&schema); }
+	return rc == TINI_SUCCESS && !failed ? 0 : 1;
+}